@@ -68,6 +68,20 @@ Example usage:
 	// No deconstructors here, you just have to remember to free it.
 	vertices.free();
 
+	// hashmap_t is a hash table with amortized O(1) add, get and remove.
+	hashmap_t<int32_t, vec3> points = {};
+	points.add(10, vec3{1,0,0});
+	points.add(20, vec3{0,1,0});
+	vec3 *p = points.get(10);
+	points.remove(20);
+
+	// Entries are kept dense, so keys and items work like any other array.
+	for (size_t i=0; i<points.items.count; i+=1) {
+		points.items[i] += vec3{1,1,1};
+	}
+	points.each([](const int32_t &key, vec3 &v){ v += vec3{1,1,1}; });
+	points.free();
+
 */
 
 #pragma once
@@ -102,6 +116,20 @@ Example usage:
 #define ARRAY_ASSERT assert
 #endif
 
+// hashmap_swiss_t probes 16 slots at a time with SSE2 when it's available.
+// Define ARRAY_NO_SIMD to force the portable scalar path.
+#if !defined(ARRAY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ARRAY_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+inline static uint32_t _array_ctz(uint32_t bits) { unsigned long result; _BitScanForward(&result, bits); return (uint32_t)result; }
+#else
+inline static uint32_t _array_ctz(uint32_t bits) { return (uint32_t)__builtin_ctz(bits); }
+#endif
+
 //////////////////////////////////////
 // array_view_t                     //
 //////////////////////////////////////
@@ -205,47 +233,150 @@ struct array_t {
 // hashmap_t                        //
 //////////////////////////////////////
 
+// FNV-1a 64 over the raw bytes of a key, shared by the hashmap types.
+inline static uint64_t _array_hash(const void *key, size_t size) {
+	uint64_t       hash  = 14695981039346656037UL;
+	const uint8_t *bytes = (const uint8_t *)key;
+	for (size_t i=0; i<size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211;
+	return hash;
+}
+
+// hashmap_t keeps its entries dense, like C#'s Dictionary: hashes, keys
+// and items are plain arrays with one element per entry, so they can be
+// walked and counted like any other array_t. Lookups go through _slots, an
+// open addressing table using Robin Hood probing, so add, get and remove
+// are amortized O(1). Each slot holds the low 32 bits of its entry's hash
+// next to the entry's index, so probing stays in that one table, and keys
+// are only compared (bytewise, like the hash) when those bits match, so
+// collisions can't alias. The table is a power of two in size, and grows
+// when it passes 3/4 full. Ids from add and contains are indices into
+// items, and stay good until a remove, which moves the last entry into
+// the gap. remove uses backward shift deletion rather than tombstones, so
+// probe lengths stay as short after a remove as if the key was never
+// added. reserve sizes everything up front, and build uses it to fill a
+// map from arrays of keys and values with no regrowth along the way.
+
 template <typename K, typename T>
 struct hashmap_t {
+	struct _slot_t {
+		uint32_t hash;  // Low bits of the entry's hash
+		uint32_t index; // Entry index + 1, 0 marks an empty slot
+	};
+
 	array_t<uint64_t> hashes;
+	array_t<K>        keys;
 	array_t<T>        items;
+	array_t<_slot_t>  _slots;
 
-	uint64_t _hash(const K &key) const {
-		uint64_t       hash  = 14695981039346656037UL;
-		const uint8_t *bytes = (const uint8_t *)&key;
-		for (size_t i=0; i<sizeof(K); i++)
-			hash = (hash ^ bytes[i]) * 1099511628211;
-		return hash;
+	uint64_t _hash     (const K &key) const { return _array_hash(&key, sizeof(K)); }
+	int64_t  _find_slot(uint64_t hash, const K &key) const;
+	int64_t  _find     (uint64_t hash, const K &key) const { int64_t slot = _find_slot(hash, key); return slot < 0 ? -1 : (int64_t)_slots[slot].index - 1; }
+	int64_t  _append   (uint64_t hash, const K &key, const T &value);
+	void     _place    (uint32_t hash, uint32_t index);
+	void     _rehash   (size_t slots);
+	static size_t _slots_for(size_t count) { size_t slots = 16; while (count*4 > slots*3) slots *= 2; return slots; }
+
+	int64_t add(const K &key, const T &value) {
+		uint64_t hash = _hash(key);
+		int64_t  id   = _find(hash, key);
+		if (id < 0) id = _append(hash, key, value);
+		return id;
 	}
+	int64_t add_or_set(const K &key, const T &value) {
+		uint64_t hash = _hash(key);
+		int64_t  id   = _find(hash, key);
+		if (id < 0) id = _append(hash, key, value);
+		else        items[id] = value;
+		return id;
+	}
+
+	T       *get     (const K &key)                         const { int64_t id = _find(_hash(key), key); return id<0 ? nullptr       : &items[id]; }
+	const T &get_or  (const K &key, const T &default_value) const { int64_t id = _find(_hash(key), key); return id<0 ? default_value :  items[id]; }
+	int64_t  contains(const K &key)                         const { return _find(_hash(key), key); }
+	int64_t  next    (int64_t id)                           const { return id + 1 < (int64_t)items.count ? id + 1 : -1; }
+	void     each    (void (*e)(const K &key, T &item))                                   { for (size_t i=0; i<items.count; i++) e(keys[i], items[i]); }
+	void     each    (void (*e)(const K &key, T &item, void *user_data), void *user_data) { for (size_t i=0; i<items.count; i++) e(keys[i], items[i], user_data); }
+	bool     remove  (const K &key);
+	void     clear   ()                                           { if (_slots.data) memset(_slots.data, 0, sizeof(_slot_t) * _slots.count); hashes.clear(); keys.clear(); items.clear(); }
+	void     reserve (size_t to_count);
+	void     build   (const K *keys, const T *values, size_t n);
+	void     free    ()                                           { hashes.free(); keys.free(); items.free(); _slots.free(); }
+};
+
+//////////////////////////////////////
+// hashmap_swiss_t                  //
+//////////////////////////////////////
+
+// hashmap_swiss_t has the same methods as hashmap_t, but stores entries
+// right in its table instead of in dense arrays: ctrl, keys and items hold
+// one element per slot, with empty slots mixed in. So count holds the
+// number of entries, iteration has to go through next or each, and ids are
+// slot indices that are only good until the next add. Each slot gets a
+// single control byte, and slots come in groups of 16. A lookup compares
+// the top 7 bits of the hash against a whole group's control bytes at
+// once, so most gets only touch one cache line of ctrl before checking a
+// key. It fills to 7/8 before growing. Groups can't be shifted back like
+// hashmap_t's slots, so remove leaves a _deleted marker when the group is
+// full, and a rehash at the same size clears them out once they eat into
+// the free space.
+
+template <typename K, typename T>
+struct hashmap_swiss_t {
+	array_t<uint8_t> ctrl;
+	array_t<K>       keys;
+	array_t<T>       items;
+	size_t           count;
+	size_t           _deleted_count;
+
+	static const uint8_t _empty   = 0x80;
+	static const uint8_t _deleted = 0xFE;
+	static const size_t  _group   = 16;
+
+	uint64_t        _hash  (const K &key) const { return _array_hash(&key, sizeof(K)); }
+	static uint32_t _match (const uint8_t *group, uint8_t value);
+	int64_t         _find  (uint64_t hash, const K &key) const;
+	int64_t         _place (uint64_t hash, const K &key, const T &value);
+	void            _rehash(size_t slots);
+	void            _grow  () { _rehash(ctrl.count == 0 ? _group : (count+1)*16 > ctrl.count*7 ? ctrl.count * 2 : ctrl.count); }
+	static size_t   _slots_for(size_t count) { size_t slots = _group; while (count*8 > slots*7) slots *= 2; return slots; }
 
 	int64_t add(const K &key, const T &value) {
 		uint64_t hash = _hash(key);
-		int64_t  id   = hashes.binary_search(hash);
+		int64_t  id   = _find(hash, key);
 		if (id < 0) {
-			id = ~id;
-			hashes.insert(id, hash );
-			items .insert(id, value);
+			if ((count+_deleted_count+1)*8 > ctrl.count*7)
+				_grow();
+			id = _place(hash, key, value);
 		}
 		return id;
 	}
 	int64_t add_or_set(const K &key, const T &value) {
 		uint64_t hash = _hash(key);
-		int64_t  id   = hashes.binary_search(hash);
+		int64_t  id   = _find(hash, key);
 		if (id < 0) {
-			id = ~id;
-			hashes.insert(id, hash );
-			items .insert(id, value);
+			if ((count+_deleted_count+1)*8 > ctrl.count*7)
+				_grow();
+			id = _place(hash, key, value);
 		} else {
-			hashes[id] = hash;
-			items [id] = value;
+			items[id] = value;
 		}
 		return id;
 	}
 
-	T       *get     (const K &key)                         const { int64_t id = hashes.binary_search(_hash(key)); return id<0 ? nullptr       : &items[id]; }
-	const T &get_or  (const K &key, const T &default_value) const { int64_t id = hashes.binary_search(_hash(key)); return id<0 ? default_value :  items[id]; }
-	int64_t  contains(const K &key)                         const { return hashes.binary_search(_hash(key)); }
-	void     free    ()                                           { hashes.free(); items.free(); }
+	T       *get     (const K &key)                         const { int64_t id = _find(_hash(key), key); return id<0 ? nullptr       : &items[id]; }
+	const T &get_or  (const K &key, const T &default_value) const { int64_t id = _find(_hash(key), key); return id<0 ? default_value :  items[id]; }
+	int64_t  contains(const K &key)                         const { return _find(_hash(key), key); }
+	int64_t  next    (int64_t id)                           const { for (size_t i = id + 1; i < ctrl.count; i++) if (ctrl[i] < _empty) return i; return -1; }
+	void     each    (void (*e)(const K &key, T &item))                                   { for (int64_t i = next(-1); i >= 0; i = next(i)) e(keys[i], items[i]); }
+	void     each    (void (*e)(const K &key, T &item, void *user_data), void *user_data) { for (int64_t i = next(-1); i >= 0; i = next(i)) e(keys[i], items[i], user_data); }
+	bool     remove  (const K &key);
+	void     clear   ()                                           { if (ctrl.data) memset(ctrl.data, _empty, ctrl.count); count = 0; _deleted_count = 0; }
+	// _deleted slots still hold probes open, so they count against the load
+	// here too, and a same size rehash clears them out if needed.
+	void     reserve (size_t to_count)                            { size_t slots = _slots_for(to_count); if (slots > ctrl.count) _rehash(slots); else if ((to_count+_deleted_count)*8 > ctrl.count*7) _rehash(ctrl.count); }
+	void     build   (const K *keys, const T *values, size_t n);
+	void     free    ()                                           { ctrl.free(); keys.free(); items.free(); count = 0; _deleted_count = 0; }
 };
 
 //////////////////////////////////////
@@ -273,7 +404,7 @@ void array_t<T>::resize(size_t to_capacity) {
 
 	void  *old_memory = data;
 	void  *new_memory = ARRAY_MALLOC(sizeof(T) * to_capacity); 
-	memcpy(new_memory, old_memory, sizeof(T) * count);
+	if (count > 0) memcpy(new_memory, old_memory, sizeof(T) * count);
 
 	data = (T*)new_memory;
 	ARRAY_FREE(old_memory);
@@ -337,6 +468,274 @@ void array_t<T>::reverse() {
 	}
 }
 
+//////////////////////////////////////
+// hashmap_t methods                //
+//////////////////////////////////////
+
+template <typename K, typename T>
+int64_t hashmap_t<K,T>::_find_slot(uint64_t hash, const K &key) const {
+	if (_slots.count == 0) return -1;
+
+	size_t   mask = _slots.count - 1;
+	size_t   at   = hash & mask;
+	uint32_t bits = (uint32_t)hash;
+	for (size_t dist = 0; ; dist++) {
+		_slot_t curr = _slots[at];
+		// Robin Hood keeps each probe sequence sorted by distance from home,
+		// so once we pass an entry closer to its home than we are, we're done.
+		if (curr.index == 0 || ((at - (curr.hash & mask)) & mask) < dist) return -1;
+		if (curr.hash == bits && memcmp(&keys[curr.index - 1], &key, sizeof(K)) == 0) return at;
+		at = (at + 1) & mask;
+	}
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+void hashmap_t<K,T>::_place(uint32_t hash, uint32_t index) {
+	size_t  mask = _slots.count - 1;
+	size_t  at   = hash & mask;
+	_slot_t slot = { hash, index };
+	for (size_t dist = 0; ; dist++) {
+		_slot_t curr = _slots[at];
+		if (curr.index == 0) {
+			_slots[at] = slot;
+			return;
+		}
+		// Steal the slot from entries that are closer to home than we are,
+		// and carry the displaced entry on down the line.
+		size_t curr_dist = (at - (curr.hash & mask)) & mask;
+		if (curr_dist < dist) {
+			_slots[at] = slot;
+			slot = curr;
+			dist = curr_dist;
+		}
+		at = (at + 1) & mask;
+	}
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+int64_t hashmap_t<K,T>::_append(uint64_t hash, const K &key, const T &value) {
+	if ((items.count+1)*4 > _slots.count*3)
+		_rehash(_slots.count < 16 ? 16 : _slots.count * 2);
+
+	hashes.add(hash);
+	keys  .add(key);
+	size_t id = items.add(value);
+	_place((uint32_t)hash, (uint32_t)id + 1);
+	return id;
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+void hashmap_t<K,T>::_rehash(size_t slots) {
+	// Entries keep their full hash, so nothing needs hashed again
+	_slots.free();
+	_slots = { (_slot_t*)ARRAY_MALLOC(sizeof(_slot_t) * slots), slots, slots };
+	memset(_slots.data, 0, sizeof(_slot_t) * slots);
+	for (size_t i=0; i<hashes.count; i++)
+		_place((uint32_t)hashes[i], (uint32_t)i + 1);
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+bool hashmap_t<K,T>::remove(const K &key) {
+	int64_t slot = _find_slot(_hash(key), key);
+	if (slot < 0) return false;
+	size_t id = _slots[slot].index - 1;
+
+	// Shift the rest of the probe run back a slot, until we hit an empty
+	// slot or an entry that's already sitting in its home slot.
+	size_t mask = _slots.count - 1;
+	size_t at   = slot;
+	while (true) {
+		size_t  next = (at + 1) & mask;
+		_slot_t curr = _slots[next];
+		if (curr.index == 0 || ((next - (curr.hash & mask)) & mask) == 0) break;
+		_slots[at] = curr;
+		at = next;
+	}
+	_slots[at] = {};
+
+	// The last entry fills the gap to keep things dense, and its slot gets
+	// pointed at the new spot.
+	size_t last = items.count - 1;
+	if (id != last) {
+		hashes[id] = hashes[last];
+		keys  [id] = keys  [last];
+		items [id] = items [last];
+		at = hashes[id] & mask;
+		while (_slots[at].index != last + 1) at = (at + 1) & mask;
+		_slots[at].index = (uint32_t)id + 1;
+	}
+	hashes.pop();
+	keys  .pop();
+	items .pop();
+	return true;
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+void hashmap_t<K,T>::reserve(size_t to_count) {
+	if (items.capacity < to_count) {
+		hashes.resize(to_count);
+		keys  .resize(to_count);
+		items .resize(to_count);
+	}
+	size_t slots = _slots_for(to_count);
+	if (slots > _slots.count) _rehash(slots);
+}
+
+//////////////////////////////////////
+
+// Adds n key/value pairs, where later duplicates overwrite earlier ones the
+// same as add_or_set. Everything is sized for all of them first, so this
+// is a single pass with no regrowth.
+template <typename K, typename T>
+void hashmap_t<K,T>::build(const K *in_keys, const T *in_values, size_t n) {
+	reserve(items.count + n);
+	for (size_t i = 0; i < n; i++) {
+		uint64_t hash = _hash(in_keys[i]);
+		int64_t  id   = _find(hash, in_keys[i]);
+		if (id < 0) _append(hash, in_keys[i], in_values[i]);
+		else        items[id] = in_values[i];
+	}
+}
+
+//////////////////////////////////////
+// hashmap_swiss_t methods          //
+//////////////////////////////////////
+
+// Returns a bit for each of the 16 control bytes in group equal to value.
+template <typename K, typename T>
+uint32_t hashmap_swiss_t<K,T>::_match(const uint8_t *group, uint8_t value) {
+#if defined(ARRAY_SSE2)
+	__m128i bytes = _mm_loadu_si128((const __m128i *)group);
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)value)));
+#else
+	// SWAR fallback, 8 bytes at a time: set the high bit of each byte that
+	// matches, then gather those high bits down into an 8 bit mask.
+	uint32_t result = 0;
+	for (uint32_t half = 0; half < 2; half++) {
+		uint64_t word;
+		memcpy(&word, group + half*8, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		word = __builtin_bswap64(word);
+#endif
+		uint64_t x    = word ^ (0x0101010101010101ULL * value);
+		uint64_t high = ~(((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x | 0x7F7F7F7F7F7F7F7FULL);
+		result |= (uint32_t)(((high >> 7) * 0x0102040810204080ULL) >> 56) << (half*8);
+	}
+	return result;
+#endif
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+int64_t hashmap_swiss_t<K,T>::_find(uint64_t hash, const K &key) const {
+	if (ctrl.count == 0) return -1;
+
+	// Groups are probed quadratically, which visits every group when the
+	// group count is a power of two.
+	size_t  group_mask = ctrl.count / _group - 1;
+	size_t  group      = hash & group_mask;
+	uint8_t tag        = (uint8_t)(hash >> 57);
+	for (size_t step = 1; ; step++) {
+		const uint8_t *g = &ctrl[group * _group];
+		for (uint32_t bits = _match(g, tag); bits; bits &= bits - 1) {
+			size_t at = group * _group + _array_ctz(bits);
+			if (memcmp(&keys[at], &key, sizeof(K)) == 0) return at;
+		}
+		if (_match(g, _empty)) return -1;
+		group = (group + step) & group_mask;
+	}
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+int64_t hashmap_swiss_t<K,T>::_place(uint64_t hash, const K &key, const T &value) {
+	size_t group_mask = ctrl.count / _group - 1;
+	size_t group      = hash & group_mask;
+	for (size_t step = 1; ; step++) {
+		const uint8_t *g    = &ctrl[group * _group];
+		uint32_t       bits = _match(g, _empty) | _match(g, _deleted);
+		if (bits) {
+			size_t at = group * _group + _array_ctz(bits);
+			if (ctrl[at] == _deleted) _deleted_count -= 1;
+			ctrl [at] = (uint8_t)(hash >> 57);
+			keys [at] = key;
+			items[at] = value;
+			count += 1;
+			return at;
+		}
+		group = (group + step) & group_mask;
+	}
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+void hashmap_swiss_t<K,T>::_rehash(size_t slots) {
+	array_t<uint8_t> old_ctrl  = ctrl;
+	array_t<K>       old_keys  = keys;
+	array_t<T>       old_items = items;
+
+	ctrl  = { (uint8_t*)ARRAY_MALLOC(slots),             slots, slots };
+	keys  = { (K      *)ARRAY_MALLOC(sizeof(K) * slots), slots, slots };
+	items = { (T      *)ARRAY_MALLOC(sizeof(T) * slots), slots, slots };
+	memset(ctrl.data, _empty, slots);
+	count          = 0;
+	_deleted_count = 0;
+
+	for (size_t i=0; i<old_ctrl.count; i++) {
+		if (old_ctrl[i] < _empty)
+			_place(_hash(old_keys[i]), old_keys[i], old_items[i]);
+	}
+	old_ctrl .free();
+	old_keys .free();
+	old_items.free();
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+bool hashmap_swiss_t<K,T>::remove(const K &key) {
+	int64_t id = _find(_hash(key), key);
+	if (id < 0) return false;
+
+	// Probes only move on from a group when it has no empty slots, so if
+	// this group has one, nothing probes past it and the slot can just be
+	// emptied. Otherwise, leave a marker so probes keep going.
+	if (_match(&ctrl[(id / _group) * _group], _empty)) {
+		ctrl[id] = _empty;
+	} else {
+		ctrl[id]  = _deleted;
+		_deleted_count += 1;
+	}
+	count -= 1;
+	return true;
+}
+
+//////////////////////////////////////
+
+template <typename K, typename T>
+void hashmap_swiss_t<K,T>::build(const K *in_keys, const T *in_values, size_t n) {
+	reserve(count + n);
+	for (size_t i = 0; i < n; i++) {
+		uint64_t hash = _hash(in_keys[i]);
+		int64_t  id   = _find(hash, in_keys[i]);
+		if (id < 0) _place(hash, in_keys[i], in_values[i]);
+		else        items[id] = in_values[i];
+	}
+}
+
 //////////////////////////////////////
 // array_view_t methods             //
 //////////////////////////////////////
@@ -3,10 +3,11 @@
 micro_ply.h
 	Written by Nick Klingensmith, @koujaku on Twitter, @maluoi on GitHub
 
-	This is a small ASCII .ply loader and converter. It's intended to be as
-	short as possible, while still being easily readable! The idea is that it
-	can be trivially embedded in another single header library or single file
-	project without too much trouble.
+	This is a small .ply loader and converter, for both ASCII and binary
+	files. It's intended to be as short as possible, while still being
+	easily readable! The idea is that it can be trivially embedded in
+	another single header library or single file project without too much
+	trouble.
 	
 Example usage:
 
@@ -62,6 +63,12 @@ Example usage:
 		{ PLY_PROP_COLOR_A,     ply_prop_uint,    sizeof(uint8_t), 35, &white }, };
 	ply_convert(&file, PLY_ELEMENT_VERTICES, map_verts, _countof(map_verts), sizeof(skg_vert_t), (void **)out_verts, out_vert_count);
 
+	// If you'd like colors as floats instead, ply_prop_normalized will
+	// scale integer values into the 0-1 range for you.
+	float     fone = 1;
+	ply_map_t map_colors[] = {
+		{ PLY_PROP_COLOR_R, ply_prop_normalized, sizeof(float), 0, &fone } };
+
 	// Properties defined as lists in the PLY format will get triangulated 
 	// during conversion, so you don't need to worry about quads or n-gons in 
 	// the geometry.
@@ -69,14 +76,140 @@ Example usage:
 	ply_map_t map_inds[] = { { PLY_PROP_INDICES, ply_prop_uint, sizeof(uint32_t), 0, &izero } };
 	ply_convert(&file, PLY_ELEMENT_FACES, map_inds, _countof(map_inds), sizeof(uint32_t), (void **)out_indices, out_ind_count);
 
-	// You gotta free the memory manually!
+	// Any row's list can also be looked up directly, if you need the raw
+	// polygons. Items are in the list property's own type.
+	int32_t  count;
+	const int32_t *face = (const int32_t *)ply_get_list(&file.elements[1], 0, face_id, &count);
+
+	// Elements can mix list and regular properties, like faces with flags
+	// or colors. A map only gets triangulated when its first entry names a
+	// list, otherwise it converts one item per face like any other element.
+	ply_map_t map_face_col[] = { { PLY_PROP_COLOR_R, ply_prop_uint, sizeof(uint8_t), 0, &white } };
+	ply_convert(&file, PLY_ELEMENT_FACES, map_face_col, _countof(map_face_col), sizeof(uint8_t), (void **)out_face_reds, out_face_count);
+
+	// If you'd rather have it somewhere of your own, like a GPU staging
+	// buffer, ask how many items a conversion makes and hand it the memory.
+	int32_t vert_count = ply_convert_count(&file, PLY_ELEMENT_VERTICES, map_verts, _countof(map_verts));
+	void   *staging    = gpu_staging_map(vert_count * sizeof(skg_vert_t));
+	ply_convert_into(&file, PLY_ELEMENT_VERTICES, map_verts, _countof(map_verts), sizeof(skg_vert_t), nullptr, staging, vert_count, &vert_count);
+
+	// You gotta free the memory manually! Everything micro_ply.h allocates
+	// goes through MICRO_PLY_MALLOC, MICRO_PLY_REALLOC and MICRO_PLY_FREE,
+	// which you can define before the implementation to use your own
+	// allocator. Each read below fills the file from scratch, so free it
+	// before reading into it again.
+	ply_free(&file);
+
+	// For binary little endian files, ply_read_ex can skip copying element
+	// data entirely and point right into your buffer instead. This only
+	// happens for elements without list properties, and means your buffer
+	// has to stick around until after ply_free!
+	ply_read_opts_t opts = { ply_read_zero_copy };
+	ply_read_ex(data, size, &opts, &file);
+	ply_free(&file);
+
+	// Big ASCII files can be parsed in parallel too. micro_ply.h doesn't
+	// have any threading of its own, so you'll need to hook it up to
+	// whatever job system you're using.
+	opts.dispatch = [](void *, ply_job_fn job, void *job_data, int32_t count) {
+		#pragma omp parallel for
+		for (int32_t i = 0; i < count; i++) job(job_data, i);
+	};
+	ply_read_ex(data, size, &opts, &file);
+
+	// Only once nothing is pointing into it can your buffer go.
 	ply_free(&file);
 	free(data);
+
+	// Or skip reading the file yourself, and let ply_read_file do it. On
+	// Linux and Mac this memory maps the file, so combined with zero copy,
+	// big binary files get paged in as they're used instead of all up front.
+	// The file stays open until ply_free. Define MICRO_PLY_NO_MMAP to use
+	// plain fread instead, or MICRO_PLY_NO_FILE to leave file IO out
+	// entirely.
+	ply_read_file(filename, &opts, &file);
+	ply_free(&file);
+
+	// If you'll only convert some of the properties, like just positions
+	// for a thumbnail, ply_read_lazy leaves elements without lists in the
+	// source, and conversion only decodes the columns it needs. Like zero
+	// copy, the data needs to stick around until after ply_free.
+	opts.flags = ply_read_lazy;
+	ply_read_file(filename, &opts, &file);
+
+	// Converting one element into several layouts can happen in a single
+	// pass over the file's rows.
+	ply_map_t map_collide[] = {
+		{ PLY_PROP_POSITION_X, ply_prop_decimal, sizeof(float), 0, &fzero },
+		{ PLY_PROP_POSITION_Y, ply_prop_decimal, sizeof(float), 4, &fzero },
+		{ PLY_PROP_POSITION_Z, ply_prop_decimal, sizeof(float), 8, &fzero } };
+	ply_convert_target_t targets[] = {
+		{ map_verts,   _countof(map_verts),   sizeof(skg_vert_t) },
+		{ map_collide, _countof(map_collide), sizeof(float)*3 } };
+	ply_convert_multi(&file, PLY_ELEMENT_VERTICES, targets, _countof(targets));
+
+	// Or, if you'd like each property in an array of its own, the SoA
+	// variant ignores to_offset and gives you one tightly packed array for
+	// each map entry.
+	float  *soa[3];
+	int32_t soa_count;
+	ply_convert_soa(&file, PLY_ELEMENT_VERTICES, map_collide, _countof(map_collide), (void **)soa, &soa_count);
+
+	// Lots of exporters duplicate vertices for every face. Welding converts
+	// vertices and indices together, merging vertices whose converted
+	// values match exactly, and remapping the indices to the merged list.
+	ply_convert_welded(&file,
+		PLY_ELEMENT_VERTICES, map_verts, _countof(map_verts), sizeof(skg_vert_t),
+		PLY_ELEMENT_FACES,    map_inds,  _countof(map_inds),  sizeof(uint32_t),
+		(void **)out_verts, out_vert_count, (void **)out_indices, out_ind_count);
+
+	// Scanners tend to write faces in a fairly random order, which is hard
+	// on the GPU's vertex cache. These reorder triangles to reuse recently
+	// transformed vertices, and then vertices into the order they're used.
+	ply_optimize_vertex_cache(*out_indices, *out_ind_count, *out_vert_count);
+	ply_optimize_vertex_fetch(*out_verts, *out_vert_count, sizeof(skg_vert_t), *out_indices, *out_ind_count);
+
+	// The same hook can split up triangulating big face lists.
+	ply_convert_opts_t convert_opts = { opts.dispatch };
+	ply_convert_ex(&file, PLY_ELEMENT_FACES, map_inds, _countof(map_inds), sizeof(uint32_t), &convert_opts, (void **)out_indices, out_ind_count);
+
+	// If the file is too big to hold in memory, or you'd like to convert
+	// while it's still loading, you can stream it in instead. Data can be
+	// fed in pieces of any size, and callbacks get batches of converted
+	// rows as soon as they're ready. The ply_map_t arrays need to stick
+	// around until ply_stream_end.
+	ply_stream_t stream;
+	ply_stream_begin(&stream, 4096);
+	ply_stream_map  (&stream, PLY_ELEMENT_VERTICES, map_verts, _countof(map_verts), sizeof(skg_vert_t), on_verts, &my_mesh);
+	ply_stream_map  (&stream, PLY_ELEMENT_FACES,    map_inds,  _countof(map_inds),  sizeof(uint32_t),   on_inds,  &my_mesh);
+	while ((size = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+		ply_stream_feed(&stream, chunk, size);
+	if (!ply_stream_end(&stream))
+		return false;
+
+	// Meshes can be written back out as binary PLY files, in this machine's
+	// byte order (so binary_little_endian on pretty much everything).
+	// The sink gets the file in chunks, so it can go straight to disk.
+	ply_write_fn to_file = [](void *fp, const void *data, size_t size) {
+		return fwrite(data, 1, size, (FILE*)fp) == size;
+	};
+	ply_write(&file, to_file, fp);
+
+	// Or from your own structs, described with ply_map_t like conversion.
+	ply_write_element_t out_elements[] = {
+		{ PLY_ELEMENT_VERTICES, verts, vert_count, map_verts, _countof(map_verts), sizeof(skg_vert_t) },
+		{ PLY_ELEMENT_FACES,    inds,  ind_count/3, map_inds, _countof(map_inds),  sizeof(uint32_t)*3, 3 } };
+	ply_write_data(out_elements, _countof(out_elements), to_file, fp);
+
+	// ply_read_file's memory belongs to the file, so ply_free is all it
+	// needs.
+	ply_free(&file);
 */
 
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define PLY_PROP_POSITION_X "x"
 #define PLY_PROP_POSITION_Y "y"
@@ -94,14 +227,38 @@ Example usage:
 #define PLY_ELEMENT_VERTICES "vertex"
 #define PLY_ELEMENT_FACES "face"
 
+// Name hashes for the above, these match hashc_constfnv32_string and
+// hash_constfnv32_string from ferr_hash.h, and ply_prop_t::name_hash, so
+// you can switch on the properties of a file without comparing strings.
+#define PLY_HASH_POSITION_X 0xaafb22bdu
+#define PLY_HASH_POSITION_Y 0x445eb9bcu
+#define PLY_HASH_POSITION_Z 0x7833f4bfu
+#define PLY_HASH_NORMAL_X   0x48d7f733u
+#define PLY_HASH_NORMAL_Y   0x6aa41f98u
+#define PLY_HASH_NORMAL_Z   0x053fa669u
+#define PLY_HASH_TEXCOORD_X 0xdcb443b6u
+#define PLY_HASH_TEXCOORD_Y 0xdba636b1u
+#define PLY_HASH_COLOR_R    0x5c9a5114u
+#define PLY_HASH_COLOR_G    0x379b8494u
+#define PLY_HASH_COLOR_B    0x5a7147fdu
+#define PLY_HASH_COLOR_A    0xe7caecf9u
+#define PLY_HASH_INDICES    0x441a84e4u
+
 ///////////////////////////////////////////
 
 typedef enum ply_prop_ {
 	ply_prop_int = 1,
 	ply_prop_uint,
 	ply_prop_decimal,
+	ply_prop_normalized, // Only for ply_map_t::to_type, a decimal where integer values get scaled to 0-1 (or -1-1 when signed)
 } ply_prop_;
 
+typedef enum ply_read_ {
+	ply_read_default   = 0,
+	ply_read_zero_copy = 1 << 0,
+	ply_read_lazy      = 1 << 1, // Elements without lists stay in the source until they're converted, see ply_element_t::lazy_rows
+} ply_read_;
+
 typedef struct ply_prop_t {
 	uint8_t  bytes;
 	uint8_t  type; // follows ply_prop_
@@ -109,21 +266,32 @@ typedef struct ply_prop_t {
 	uint8_t  list_type;
 	uint16_t offset;
 	char     name[32];
+	uint32_t name_hash;
+	uint64_t list_offset; // Where this list's items start in list_data, in bytes
 } ply_prop_t;
 
 typedef struct ply_element_t {
 	char        name[64];
+	uint32_t    name_hash;
 	int32_t     count;
 	ply_prop_t *properties; 
 	int32_t     property_count; 
 	void       *data;
 	int32_t     data_stride; 
 	void       *list_data;
+	uint64_t   *list_offsets;  // count+1 offsets for each list property, in items from the start of the property's list_data
+	bool        data_borrowed; // data points into the caller's buffer, and isn't ours to free
+	const void *lazy_rows;     // For ply_read_lazy, where the undecoded rows start in the source. data is null when this is set.
+	size_t      lazy_size;
+	int32_t     lazy_format;
 } ply_element_t;
 
 typedef struct ply_file_t {
 	ply_element_t *elements;
 	int32_t        count;
+	void          *source;        // File contents, if ply_read_file loaded them
+	size_t         source_size;
+	bool           source_mapped;
 } ply_file_t;
 
 typedef struct ply_map_t {
@@ -134,11 +302,119 @@ typedef struct ply_map_t {
 	const void *default_val;
 } ply_map_t;
 
+// A job system hook. ply_dispatch_fn should call job(job_data, i) once
+// for each i in [0, job_count), on whatever threads it likes, and only
+// return once they've all finished.
+typedef void (*ply_job_fn)     (void *job_data, int32_t job_index);
+typedef void (*ply_dispatch_fn)(void *dispatch_data, ply_job_fn job, void *job_data, int32_t job_count);
+
+typedef struct ply_read_opts_t {
+	int32_t         flags;         // follows ply_read_
+	ply_dispatch_fn dispatch;      // Optional, lets ASCII data parse in parallel
+	void           *dispatch_data;
+	int32_t         job_count;     // How many pieces to split the work into, 0 for a default of 64
+} ply_read_opts_t;
+
+typedef struct ply_convert_target_t {
+	const ply_map_t *to_format;
+	int32_t          format_count;
+	int32_t          format_stride;
+	void            *out_data;  // Filled in by ply_convert_multi, free it when you're done
+	int32_t          out_count;
+} ply_convert_target_t;
+
+typedef struct ply_convert_opts_t {
+	ply_dispatch_fn dispatch;      // Optional, lets list elements triangulate in parallel
+	void           *dispatch_data;
+	int32_t         job_count;     // How many pieces to split the work into, 0 for a default of 64
+} ply_convert_opts_t;
+
+typedef void (*ply_stream_callback)(void *user_data, const void *data, int32_t count);
+
+typedef struct _ply_buffer_t {
+	uint8_t *data;
+	size_t   size;
+	size_t   capacity;
+} _ply_buffer_t;
+
+typedef struct ply_stream_target_t {
+	char                element_name[64];
+	const ply_map_t    *to_format;
+	int32_t             format_count;
+	int32_t             format_stride;
+	ply_stream_callback callback;
+	void               *user_data;
+	int32_t             element;
+	void               *out;
+	size_t              out_capacity;
+} ply_stream_target_t;
+
+typedef struct ply_stream_t {
+	ply_file_t           file;
+	int32_t              format;
+	bool                 header_done;
+	int32_t              element;
+	int32_t              row;
+	ply_stream_target_t *targets;
+	int32_t              target_count;
+	int32_t              batch_rows;
+	int32_t              batch_count;
+	uint8_t             *batch;
+	size_t               batch_capacity;
+	_ply_buffer_t       *batch_lists;  // One for each list property of the current element
+	size_t              *batch_marks;  // List sizes from before the current row
+	int32_t              batch_list_count;
+	_ply_buffer_t        batch_packed;
+	_ply_buffer_t        batch_offsets;
+	uint8_t             *carry;
+	size_t               carry_size;
+	size_t               carry_capacity;
+} ply_stream_t;
+
+// Writing hands binary data to a sink as it's ready, return false from it
+// to stop writing.
+typedef bool (*ply_write_fn)(void *user_data, const void *data, size_t size);
+
+// Describes your own data for ply_write_data. The map's to_type, to_size
+// and to_offset describe your struct's fields, and are written out as the
+// PLY's own property types.
+typedef struct ply_write_element_t {
+	const char      *name;
+	const void      *data;
+	int32_t          count;
+	const ply_map_t *format;
+	int32_t          format_count;
+	int32_t          format_stride;
+	int32_t          list_size;    // If above 0, format[0] is a list of this many items at to_offset, like 3 for triangle indices
+} ply_write_element_t;
+
 ///////////////////////////////////////////
 
 bool ply_read   (const void *data, size_t data_size, ply_file_t *out_file);
+bool ply_read_ex(const void *data, size_t data_size, const ply_read_opts_t *opts, ply_file_t *out_file);
+#ifndef MICRO_PLY_NO_FILE
+bool ply_read_file(const char *filename, const ply_read_opts_t *opts, ply_file_t *out_file);
+#endif
 void ply_free   (ply_file_t *file);
 void ply_convert(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t to_format_count, int32_t format_stride, void **out_data, int32_t *out_count);
+void ply_convert_ex(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t to_format_count, int32_t format_stride, const ply_convert_opts_t *opts, void **out_data, int32_t *out_count);
+void ply_convert_multi(const ply_file_t *file, const char *element_name, ply_convert_target_t *targets, int32_t target_count);
+void ply_convert_soa  (const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t to_format_count, void **out_arrays, int32_t *out_count);
+int32_t ply_convert_count(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t to_format_count);
+bool    ply_convert_into (const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t to_format_count, int32_t format_stride, const ply_convert_opts_t *opts, void *out_data, int32_t out_capacity, int32_t *out_count);
+bool    ply_convert_welded(const ply_file_t *file, const char *vert_element, const ply_map_t *vert_format, int32_t vert_format_count, int32_t vert_stride, const char *ind_element, const ply_map_t *ind_format, int32_t ind_format_count, int32_t ind_stride, void **out_verts, int32_t *out_vert_count, void **out_inds, int32_t *out_ind_count);
+const void *ply_get_list(const ply_element_t *element, int32_t property, int32_t row, int32_t *out_count);
+
+void ply_optimize_vertex_cache(uint32_t *indices, int32_t index_count, int32_t vertex_count);
+void ply_optimize_vertex_fetch(void *vertices, int32_t vertex_count, int32_t vertex_stride, uint32_t *indices, int32_t index_count);
+
+void ply_stream_begin(ply_stream_t *stream, int32_t batch_rows);
+void ply_stream_map  (ply_stream_t *stream, const char *element_name, const ply_map_t *to_format, int32_t to_format_count, int32_t format_stride, ply_stream_callback callback, void *user_data);
+bool ply_stream_feed (ply_stream_t *stream, const void *data, size_t data_size);
+bool ply_stream_end  (ply_stream_t *stream);
+
+bool ply_write     (const ply_file_t *file, ply_write_fn write, void *user_data);
+bool ply_write_data(const ply_write_element_t *elements, int32_t element_count, ply_write_fn write, void *user_data);
 
 ///////////////////////////////////////////
 
@@ -146,310 +422,2285 @@ void ply_convert(const ply_file_t *file, const char *element_name, const ply_map
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+// Options for customizing memory allocation! Memory handed back to you,
+// like ply_convert's output, comes from MICRO_PLY_MALLOC as well.
+#ifndef MICRO_PLY_MALLOC
+#define MICRO_PLY_MALLOC malloc
+#endif
+#ifndef MICRO_PLY_REALLOC
+#define MICRO_PLY_REALLOC realloc
+#endif
+#ifndef MICRO_PLY_FREE
+#define MICRO_PLY_FREE free
+#endif
+
+void *_ply_calloc(size_t count, size_t size) {
+	void *result = MICRO_PLY_MALLOC(count * size);
+	if (result) memset(result, 0, count * size);
+	return result;
+}
+
+// Conversion of common type pairs uses SSE2, and AVX2 when the CPU has
+// it. Define MICRO_PLY_NO_SIMD to stick with plain C++.
+#if !defined(MICRO_PLY_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define _MICRO_PLY_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define _PLY_AVX2_FN
+#else
+#define _PLY_AVX2_FN __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifndef MICRO_PLY_NO_FILE
+#include <stdio.h>
+#if !defined(MICRO_PLY_NO_MMAP) && (defined(__linux__) || defined(__APPLE__))
+#define _MICRO_PLY_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
 
 ///////////////////////////////////////////
 
-void _ply_convert(uint8_t *dest, uint8_t dest_size, uint8_t dest_type, const uint8_t *src, uint8_t src_size, uint8_t src_type) {
-	if (dest_size == src_size && src_type == dest_type) memcpy(dest, src, dest_size);
-	else if (src_type == ply_prop_decimal) {
-		double val = src_size == 4
-			? *(float  *)src
-			: *(double *)src;
-		if (dest_size == 4) *(float  *)dest = (float)val;
-		else                *(double *)dest = val;
-	} else {
-		int64_t val=0;
-		if (src_type == ply_prop_int) {
-			switch (src_size) {
-			case 1: val = *(int8_t  *)src; break;
-			case 2: val = *(int16_t *)src; break;
-			case 4: val = *(int32_t *)src; break;
-			case 8: val = *(int64_t *)src; break;}
-		} else {
-			switch (src_size) {
-			case 1: val = *(uint8_t  *)src; break;
-			case 2: val = *(uint16_t *)src; break;
-			case 4: val = *(uint32_t *)src; break;
-			case 8: val = *(uint64_t *)src; break;}
-		}
-		if (dest_type == ply_prop_int) {
-			switch (dest_size) {
-			case 1: *(int8_t  *)dest = (int8_t )val; break;
-			case 2: *(int16_t *)dest = (int16_t)val; break;
-			case 4: *(int32_t *)dest = (int32_t)val; break;}
-		} else {
-			switch (dest_size) {
-			case 1: *(uint8_t *)dest = (uint8_t )val; break;
-			case 2: *(uint16_t*)dest = (uint16_t)val; break;
-			case 4: *(uint32_t*)dest = (uint32_t)val; break;}
-		}
+// Conversion kernels convert a whole column of values at a time, from
+// one strided array into another. One exists for each pair of types, and
+// copy kernels are used when the types already match. Values are loaded
+// with memcpy since PLY rows are packed, and rarely aligned.
+typedef void (*_ply_kernel_fn)(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size);
+
+template <typename S, typename D>
+void _ply_kernel(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t) {
+	for (int32_t i = 0; i < count; i++) {
+		S val;
+		memcpy(&val, src, sizeof(S));
+		D result = (D)val;
+		memcpy(dest, &result, sizeof(D));
+		src  += src_stride;
+		dest += dest_stride;
+	}
+}
+
+void _ply_kernel_copy(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size) {
+	if (size == dest_stride && size == src_stride) {
+		memcpy(dest, src, (size_t)size * count);
+		return;
+	}
+	for (int32_t i = 0; i < count; i++) {
+		memcpy(dest, src, size);
+		src  += src_stride;
+		dest += dest_stride;
 	}
 }
 
+#define _PLY_KERNEL_ROW(S) { \
+	_ply_kernel<S, int8_t >, _ply_kernel<S, uint8_t >, _ply_kernel<S, int16_t>, _ply_kernel<S, uint16_t>, \
+	_ply_kernel<S, int32_t>, _ply_kernel<S, uint32_t>, _ply_kernel<S, int64_t>, _ply_kernel<S, uint64_t>, \
+	_ply_kernel<S, float  >, _ply_kernel<S, double  > }
+const _ply_kernel_fn _ply_kernels[10][10] = {
+	_PLY_KERNEL_ROW(int8_t ), _PLY_KERNEL_ROW(uint8_t ), _PLY_KERNEL_ROW(int16_t), _PLY_KERNEL_ROW(uint16_t),
+	_PLY_KERNEL_ROW(int32_t), _PLY_KERNEL_ROW(uint32_t), _PLY_KERNEL_ROW(int64_t), _PLY_KERNEL_ROW(uint64_t),
+	_PLY_KERNEL_ROW(float  ), _PLY_KERNEL_ROW(double  ) };
+#undef _PLY_KERNEL_ROW
+
+// Integers scaled by the biggest value their type can hold
+template <typename S, typename D>
+void _ply_kernel_norm(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t) {
+	const D max = (S)-1 > 0
+		? (D)(S)-1
+		: (D)(((uint64_t)1 << (sizeof(S)*8 - 1)) - 1);
+	for (int32_t i = 0; i < count; i++) {
+		S val;
+		memcpy(&val, src, sizeof(S));
+		D result = (D)val / max;
+		if (result < -1) result = -1;
+		memcpy(dest, &result, sizeof(D));
+		src  += src_stride;
+		dest += dest_stride;
+	}
+}
+
+const _ply_kernel_fn _ply_kernels_norm[8][2] = {
+	{ _ply_kernel_norm<int8_t,  float>, _ply_kernel_norm<int8_t,  double> }, { _ply_kernel_norm<uint8_t,  float>, _ply_kernel_norm<uint8_t,  double> },
+	{ _ply_kernel_norm<int16_t, float>, _ply_kernel_norm<int16_t, double> }, { _ply_kernel_norm<uint16_t, float>, _ply_kernel_norm<uint16_t, double> },
+	{ _ply_kernel_norm<int32_t, float>, _ply_kernel_norm<int32_t, double> }, { _ply_kernel_norm<uint32_t, float>, _ply_kernel_norm<uint32_t, double> },
+	{ _ply_kernel_norm<int64_t, float>, _ply_kernel_norm<int64_t, double> }, { _ply_kernel_norm<uint64_t, float>, _ply_kernel_norm<uint64_t, double> } };
+
 ///////////////////////////////////////////
 
-bool ply_read(const void *file_data, size_t data_size, ply_file_t *out_file) {
-	// Support function, if string starts with
-	bool (*starts_with)(const char *, const char *) = [](const char *str, const char *prefix) {
-		while (*prefix) {
-			if (*prefix++ != *str++)
-				return false;
+#ifdef _MICRO_PLY_SIMD
+
+// These work on 4 or 8 values at a time. Strided sources get gathered
+// into registers, and strided destinations get their lanes stored one at
+// a time, so they work on AoS data as well as tightly packed columns.
+
+inline void _ply_store4(uint8_t *dest, int32_t dest_stride, __m128 val) {
+	if (dest_stride == sizeof(float)) {
+		_mm_storeu_ps((float*)dest, val);
+		return;
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, val);
+	memcpy(dest,                 &lanes[0], sizeof(float));
+	memcpy(dest + dest_stride,   &lanes[1], sizeof(float));
+	memcpy(dest + dest_stride*2, &lanes[2], sizeof(float));
+	memcpy(dest + dest_stride*3, &lanes[3], sizeof(float));
+}
+
+// Packed rows are rarely aligned, and this load doesn't care
+inline __m128d _ply_load_f64(const uint8_t *src) {
+	return _mm_castsi128_pd(_mm_loadl_epi64((const __m128i*)src));
+}
+
+void _ply_sse2_f64_f32(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size) {
+	int32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128d a = _mm_unpacklo_pd(_ply_load_f64(src               ), _ply_load_f64(src + src_stride  ));
+		__m128d b = _mm_unpacklo_pd(_ply_load_f64(src + src_stride*2), _ply_load_f64(src + src_stride*3));
+		_ply_store4(dest, dest_stride, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+		src  += src_stride  * 4;
+		dest += dest_stride * 4;
+	}
+	_ply_kernel<double, float>(dest, dest_stride, src, src_stride, count - i, size);
+}
+
+void _ply_sse2_u8_f32_norm(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size) {
+	const __m128 max = _mm_set1_ps(255.0f);
+	int32_t      i   = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i val = _mm_setr_epi32(src[0], src[src_stride], src[src_stride*2], src[src_stride*3]);
+		_ply_store4(dest, dest_stride, _mm_div_ps(_mm_cvtepi32_ps(val), max));
+		src  += src_stride  * 4;
+		dest += dest_stride * 4;
+	}
+	_ply_kernel_norm<uint8_t, float>(dest, dest_stride, src, src_stride, count - i, size);
+}
+
+// Gathers are slower than SSE2's paired loads for doubles, so AVX2 only
+// helps here when the doubles are packed together.
+_PLY_AVX2_FN void _ply_avx2_f64_f32(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size) {
+	int32_t i = 0;
+	if (src_stride == sizeof(double)) {
+		for (; i + 8 <= count; i += 8) {
+			__m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd((const double*)(src                 )));
+			__m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd((const double*)(src + sizeof(double)*4)));
+			_ply_store4(dest,                 dest_stride, lo);
+			_ply_store4(dest + dest_stride*4, dest_stride, hi);
+			src  += src_stride  * 8;
+			dest += dest_stride * 8;
 		}
-		return true;
-	};
-	// Support function, gets the following whitespace separated word
-	void (*get_word)(char *start, char *out, size_t out_size) = [](char *start, char *out, size_t out_size) {
-		int count = 0;
-		while (*start != ' ' && *start != '\t' && *start != '\n' && *start != '\r' && *start != '\0' && count < (out_size - 1)) {
-			out[count] = *start++;
-			count++;
+	}
+	_ply_sse2_f64_f32(dest, dest_stride, src, src_stride, count - i, size);
+}
+
+_PLY_AVX2_FN void _ply_avx2_u8_f32_norm(uint8_t *dest, int32_t dest_stride, const uint8_t *src, int32_t src_stride, int32_t count, int32_t size) {
+	const __m256 max = _mm256_set1_ps(255.0f);
+	int32_t      i   = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i val = src_stride == 1
+			? _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src))
+			: _mm256_setr_epi32(
+				src[0],            src[src_stride],   src[src_stride*2], src[src_stride*3],
+				src[src_stride*4], src[src_stride*5], src[src_stride*6], src[src_stride*7]);
+		__m256 result = _mm256_div_ps(_mm256_cvtepi32_ps(val), max);
+		if (dest_stride == sizeof(float)) {
+			_mm256_storeu_ps((float*)dest, result);
+		} else {
+			_ply_store4(dest,                 dest_stride, _mm256_castps256_ps128  (result));
+			_ply_store4(dest + dest_stride*4, dest_stride, _mm256_extractf128_ps(result, 1));
 		}
-		out[count] = '\0';
-	};
-	void (*type_info)(const char *, uint8_t *, uint8_t *) = [](const char *str, uint8_t *type, uint8_t *bytes) {
-		if      (strcmp(str, "char"  ) == 0) { *bytes = 1; *type = ply_prop_int;     }
-		else if (strcmp(str, "uchar" ) == 0) { *bytes = 1; *type = ply_prop_uint;    }
-		else if (strcmp(str, "short" ) == 0) { *bytes = 2; *type = ply_prop_int;     }
-		else if (strcmp(str, "ushort") == 0) { *bytes = 2; *type = ply_prop_uint;    }
-		else if (strcmp(str, "int"   ) == 0) { *bytes = 4; *type = ply_prop_int;     }
-		else if (strcmp(str, "uint"  ) == 0) { *bytes = 4; *type = ply_prop_uint;    }
-		else if (strcmp(str, "float" ) == 0) { *bytes = 4; *type = ply_prop_decimal; }
-		else if (strcmp(str, "double") == 0) { *bytes = 8; *type = ply_prop_decimal; }
-	};
+		src  += src_stride  * 8;
+		dest += dest_stride * 8;
+	}
+	_ply_sse2_u8_f32_norm(dest, dest_stride, src, src_stride, count - i, size);
+}
 
-	// Check file signature
-	char *file = (char*)file_data;
-	if (!starts_with(file, "ply"))
-		return false;
+bool _ply_cpu_detect_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int32_t info[4];
+	__cpuid(info, 0);
+	bool has_leaf7 = info[0] >= 7;
+	__cpuid(info, 1);
+	bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return has_leaf7 && os_avx && (info[1] & (1 << 5));
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
 
-	// File data
-	int32_t format     = 0;
-	out_file->count    = 0;
-	out_file->elements = nullptr;
+// Kernels get picked from inside conversion jobs, so the cached result
+// goes through a function local static, which C++11 initializes once in a
+// thread safe way.
+bool _ply_cpu_avx2() {
+	static const bool result = _ply_cpu_detect_avx2();
+	return result;
+}
 
-	// Read the header
-	char *line = strchr(file, '\n');
-	char  word[128];
-	while(true) {
-		if (!line) return false;
-		line += 1;
+#endif
 
-		if        (starts_with(line, "format ")) {
-			get_word(line + sizeof("format"), word, sizeof(word));
-			if      (strcmp(word, "ascii"               ) == 0) format = 0;
-			else if (strcmp(word, "binary_little_endian") == 0) format = 1;
-			else if (strcmp(word, "binary_big_endian"   ) == 0) format = 2;
-		} else if (starts_with(line, "comment ")) {
-		} else if (starts_with(line, "element ")) {
-			ply_element_t el = {};
-			get_word(line + sizeof("element"), el.name, sizeof(el.name));
-			get_word(line + sizeof("element ") + strlen(el.name), word, sizeof(word));
-			el.count = atoi(word);
+///////////////////////////////////////////
 
-			out_file->count   += 1;
-			out_file->elements = (ply_element_t*)realloc(out_file->elements, sizeof(ply_element_t) * (out_file->count));
-			out_file->elements[out_file->count - 1] = el;
-		} else if (starts_with(line, "property ")) {
-			ply_prop_t     prop = {};
-			get_word(line + sizeof("property"), word, sizeof(word));
-			
-			if (strcmp(word, "list"  ) == 0) {
-				size_t off = sizeof("property ") + strlen(word);
-				get_word(line + off, word, sizeof(word));
-				type_info(word, &prop.type, &prop.bytes);
-				off += strlen(word) + 1;
-				get_word(line + off, word, sizeof(word));
-				type_info(word, &prop.list_type, &prop.list_bytes);
-				off += strlen(word) + 1;
-				get_word(line + off, prop.name, sizeof(prop.name));
-			} else { 
-				type_info(word, &prop.type, &prop.bytes);
-				get_word(line + sizeof("property ") + strlen(word), prop.name, sizeof(prop.name));
-			}
+// Index into _ply_kernels for a type, or -1 if it's not one we know
+int32_t _ply_type_index(uint8_t type, uint8_t bytes) {
+	if (type == ply_prop_decimal) return bytes == 4 ? 8 : (bytes == 8 ? 9 : -1);
+	if (type != ply_prop_int && type != ply_prop_uint) return -1;
+	int32_t signed_offset = type == ply_prop_uint ? 1 : 0;
+	switch (bytes) {
+	case 1: return 0 + signed_offset;
+	case 2: return 2 + signed_offset;
+	case 4: return 4 + signed_offset;
+	case 8: return 6 + signed_offset;
+	default: return -1;
+	}
+}
 
-			ply_element_t *el   = &out_file->elements[out_file->count-1];
-			prop.offset = el->data_stride;
-			el->data_stride    += prop.bytes;
-			el->property_count += 1;
-			el->properties      = (ply_prop_t*)realloc(el->properties, sizeof(ply_prop_t) * el->property_count);
-			el->properties[el->property_count-1] = prop;
-		} else if (starts_with(line, "end_header")) {
-			line = strchr(line, '\n')+1;
-			break;
+_ply_kernel_fn _ply_kernel_for(uint8_t dest_size, uint8_t dest_type, uint8_t src_size, uint8_t src_type) {
+	// Normalizing only means something for integer sources
+	bool normalize = dest_type == ply_prop_normalized && src_type != ply_prop_decimal;
+	if (dest_type == ply_prop_normalized) dest_type = ply_prop_decimal;
+
+	// Same size integers cast by just copying the bits over
+	if (dest_size == src_size && !normalize && (src_type == dest_type || (src_type != ply_prop_decimal && dest_type != ply_prop_decimal)))
+		return _ply_kernel_copy;
+
+	int32_t src_index  = _ply_type_index(src_type,  src_size );
+	int32_t dest_index = _ply_type_index(dest_type, dest_size);
+	if (src_index < 0 || dest_index < 0) return nullptr;
+
+#ifdef _MICRO_PLY_SIMD
+	bool avx2 = _ply_cpu_avx2();
+	if (src_index == 9 && dest_index == 8 && !normalize) return avx2 ? _ply_avx2_f64_f32     : _ply_sse2_f64_f32;
+	if (src_index == 1 && dest_index == 8 &&  normalize) return avx2 ? _ply_avx2_u8_f32_norm : _ply_sse2_u8_f32_norm;
+#endif
+	return normalize
+		? _ply_kernels_norm[src_index][dest_index - 8]
+		: _ply_kernels     [src_index][dest_index];
+}
+
+///////////////////////////////////////////
+
+void _ply_convert(uint8_t *dest, uint8_t dest_size, uint8_t dest_type, const uint8_t *src, uint8_t src_size, uint8_t src_type) {
+	_ply_kernel_fn kernel = _ply_kernel_for(dest_size, dest_type, src_size, src_type);
+	if (kernel) kernel(dest, 0, src, 0, 1, dest_size);
+}
+
+///////////////////////////////////////////
+
+// List counts and ASCII integers are single values, where looking up a
+// kernel would cost more than the conversion itself.
+int32_t _ply_read_count(const uint8_t *src, uint8_t bytes, uint8_t type) {
+	if (type != ply_prop_decimal) {
+		switch (bytes) {
+		case 1: return type == ply_prop_int ? (int32_t)(int8_t)src[0] : (int32_t)src[0];
+		case 2: { uint16_t v; memcpy(&v, src, 2); return type == ply_prop_int ? (int32_t)(int16_t)v : (int32_t)v; }
+		case 4: { int32_t  v; memcpy(&v, src, 4); return v; }
+		case 8: { int64_t  v; memcpy(&v, src, 8); return (int32_t)v; }
 		}
-		line = strchr(line, '\n');
 	}
+	int32_t count = 0;
+	_ply_convert((uint8_t*)&count, sizeof(int32_t), ply_prop_int, src, bytes, type);
+	return count;
+}
 
-	// Parse the data
-	for (int32_t i = 0; i < out_file->count; i++) {
-		ply_element_t *el = &out_file->elements[i];
-		el->data = malloc(el->data_stride*el->count);
-		uint8_t *data = (uint8_t*)el->data;
+void _ply_store_int(uint8_t *dest, uint8_t bytes, int64_t val) {
+	switch (bytes) {
+	case 1: { uint8_t  v = (uint8_t )val; memcpy(dest, &v, 1); } break;
+	case 2: { uint16_t v = (uint16_t)val; memcpy(dest, &v, 2); } break;
+	case 4: { uint32_t v = (uint32_t)val; memcpy(dest, &v, 4); } break;
+	case 8: {                             memcpy(dest, &val, 8); } break;
+	}
+}
 
-		// If it's a list type
-		if (el->property_count == 1 && el->properties[0].list_type != 0) {
-			int32_t list_cap   = el->count * 4;
-			int32_t list_count = 0;
-			el->list_data = malloc(el->properties[0].list_bytes * list_cap);
-			uint8_t *list_data = (uint8_t*)el->list_data;
+///////////////////////////////////////////
 
-			for (int32_t e = 0; e < el->count; e++) {
-				size_t off = 0;
-				get_word(line + off, word, sizeof(word));
-				off += strlen(word) + 1;
-				int32_t count = atoi(word);
-				_ply_convert(data, el->properties[0].bytes, el->properties[0].type, (uint8_t*)&count, sizeof(double), ply_prop_int);
-				for (size_t c = 0; c < count; c++) {
-					get_word(line + off, word, sizeof(word));
-					off += strlen(word) + 1;
-					if (el->properties[0].type == ply_prop_decimal) {
-						double  val = atof(word);
-						_ply_convert(list_data, el->properties[0].list_bytes, el->properties[0].list_type, (uint8_t*)&val, sizeof(double), ply_prop_decimal);
-					} else if (el->properties[0].type == ply_prop_int) {
-						int64_t val = atol(word);
-						_ply_convert(list_data, el->properties[0].list_bytes, el->properties[0].list_type, (uint8_t*)&val, sizeof(int64_t), ply_prop_int);
-					} else {
-						uint64_t val = atol(word);
-						_ply_convert(list_data, el->properties[0].list_bytes, el->properties[0].list_type, (uint8_t*)&val, sizeof(uint64_t), ply_prop_uint);
-					}
-					list_data  += el->properties[0].list_bytes;
-					list_count += 1;
-					if (list_count >= list_cap) {
-						list_cap = (int32_t)(list_cap * 1.25f);
-						el->list_data = realloc(el->list_data, el->properties[0].list_bytes * list_cap);
-						list_data = ((uint8_t*)el->list_data) + (list_count * el->properties[0].list_bytes);
-					}
-				}
-				line = strchr(line, '\n') + 1;
-				data += el->properties[0].bytes;
-			}
-		} else {
-			for (int32_t e = 0; e < el->count; e++) {
-				size_t off = 0;
-				for (int32_t p = 0; p < el->property_count; p++) {
-					get_word(line + off, word, sizeof(word));
-					off += strlen(word) + 1;
-					if (el->properties[p].type == ply_prop_decimal) {
-						double  val = atof(word);
-						_ply_convert(data+el->properties[p].offset, el->properties[p].bytes, el->properties[p].type, (uint8_t*)&val, sizeof(double), ply_prop_decimal);
-					} else if (el->properties[p].type == ply_prop_int) {
-						int64_t val = atol(word);
-						_ply_convert(data+el->properties[p].offset, el->properties[p].bytes, el->properties[p].type, (uint8_t*)&val, sizeof(int64_t), ply_prop_int);
-					} else {
-						uint64_t val = atol(word);
-						_ply_convert(data+el->properties[p].offset, el->properties[p].bytes, el->properties[p].type, (uint8_t*)&val, sizeof(uint64_t), ply_prop_uint);
-					}
-				}
-				line = strchr(line, '\n') + 1;
-				data += el->data_stride;
-			}
-		}
+void _ply_swap(uint8_t *bytes, uint8_t size) {
+	for (uint8_t i = 0; i < size/2; i++) {
+		uint8_t tmp       = bytes[i];
+		bytes[i]          = bytes[size-1-i];
+		bytes[size-1-i]   = tmp;
 	}
+}
 
-	return true;
+///////////////////////////////////////////
+
+// Binary data needs byte swapped if the file's endianness doesn't match
+// this machine.
+bool _ply_needs_swap(int32_t format) {
+	uint16_t endian_test = 1;
+	return format != 0 && (format == 1) != (*(uint8_t*)&endian_test == 1);
 }
 
 ///////////////////////////////////////////
 
-void ply_convert(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, void **out_data, int32_t *out_count) {
-	*out_data  = nullptr;
-	*out_count = 0;
+int32_t _ply_list_prop(const ply_element_t *el) {
+	for (int32_t p = 0; p < el->property_count; p++) {
+		if (el->properties[p].list_type != 0)
+			return p;
+	}
+	return -1;
+}
 
-	// Find the elements we want to convert by name
-	const ply_element_t *elements = nullptr;
-	for (size_t i = 0; i < file->count; i++) {
-		if (strcmp(file->elements[i].name, element_name) == 0) {
-			elements = &file->elements[i];
-			break;
-		}
+///////////////////////////////////////////
+
+int32_t _ply_list_count(const ply_element_t *el) {
+	int32_t count = 0;
+	for (int32_t p = 0; p < el->property_count; p++)
+		count += el->properties[p].list_type != 0 ? 1 : 0;
+	return count;
+}
+
+///////////////////////////////////////////
+
+uint8_t *_ply_buffer_reserve(_ply_buffer_t *buffer, size_t extra) {
+	if (buffer->size + extra > buffer->capacity) {
+		buffer->capacity = buffer->capacity + buffer->capacity/4 + extra;
+		buffer->data     = (uint8_t*)MICRO_PLY_REALLOC(buffer->data, buffer->capacity);
 	}
-	if (elements == nullptr)
-		return;
+	return buffer->data + buffer->size;
+}
 
-	if (elements->list_data == nullptr) {
-		// Map the element properties to the out format
-		int32_t *map  = (int32_t*)malloc(sizeof(int32_t) * format_count);
-		for (int32_t i = 0; i < format_count; i++) {
-			map[i] = -1;
-			for (int32_t p = 0; p < elements->property_count; p++) {
-				if (strcmp(elements->properties[p].name, to_format[i].name) == 0) {
-					map[i] = p;
-					break;
-				}
-			}
-		}
+///////////////////////////////////////////
 
-		// Now convert and copy each item
-		*out_data  = malloc(elements->count * format_stride);
-		*out_count = elements->count;
-		uint8_t *src  = (uint8_t*)elements->data;
-		uint8_t *dest = (uint8_t*)*out_data;
-		for (int32_t i = 0; i < elements->count; i++) {
-			for (int32_t f = 0; f < format_count; f++) {
-				if (map[f] == -1) {
-					memcpy(dest+to_format[f].to_offset, to_format[f].default_val, to_format[f].to_size);
-				} else {
-					ply_prop_t *prop = &elements->properties[map[f]];
-					_ply_convert(
-						dest+to_format[f].to_offset, to_format[f].to_size, to_format[f].to_type,
-						src+prop->offset,            prop->bytes,          prop->type);
-				}
-			}
-			src  += elements->data_stride;
-			dest += format_stride;
-		}
+// Which of the element's lists a property is
+int32_t _ply_list_index(const ply_element_t *el, int32_t prop) {
+	int32_t index = 0;
+	for (int32_t p = 0; p < prop; p++)
+		index += el->properties[p].list_type != 0 ? 1 : 0;
+	return index;
+}
 
-		free(map);
-	} else {
-		uint8_t src_size     = elements->properties[0].bytes;
-		uint8_t src_type     = elements->properties[0].type;
-		uint8_t src_ind_size = elements->properties[0].list_bytes;
-		uint8_t src_ind_type = elements->properties[0].list_type;
-		// Count how many total indices there will be
-		int32_t count = 0;
-		uint8_t *src = (uint8_t *)elements->data;
-		for (int32_t i = 0; i < elements->count; i++) {
-			int32_t ct = 0;
-			_ply_convert((uint8_t *)&ct, sizeof(int32_t), ply_prop_int, src, src_size, src_type);
-			count += 3 + (ct-3)*3;
-			src   += src_size;
-		}
-
-		*out_data  = malloc(count * format_stride);
-		*out_count = count;
-		src              = (uint8_t*)elements->data;
-		uint8_t *src_ind = (uint8_t*)elements->list_data;
-		uint8_t *dest    = (uint8_t*)*out_data;
-		for (int32_t i = 0; i < elements->count; i++) {
-			int32_t ct = 0;
-			_ply_convert((uint8_t *)&ct, sizeof(int32_t), ply_prop_int, src, src_size, src_type);
-			for (int32_t x = 0; x < ct-2; x++) {
-				_ply_convert(
-					dest+(x*3*to_format[0].to_size), to_format[0].to_size, to_format[0].to_type,
-					src_ind, src_ind_size, src_ind_type);
-				_ply_convert(
-					dest+((x*3+1)*to_format[0].to_size), to_format[0].to_size, to_format[0].to_type,
-					src_ind+((x+1)*src_ind_size), src_ind_size, src_ind_type);
-				_ply_convert(
-					dest+((x*3+2)*to_format[0].to_size), to_format[0].to_size, to_format[0].to_type,
-					src_ind+((x+2)*src_ind_size), src_ind_size, src_ind_type);
-			}
-			src_ind += src_ind_size * ct;
-			dest    += format_stride * (3 + (ct-3)*3);
-			src     += src_size;
+///////////////////////////////////////////
+
+// Builds CSR style offsets from the counts in each row, so row r of list
+// l has its items from offsets[l*(count+1) + r] up to [... + r+1].
+void _ply_build_list_offsets(const ply_element_t *el, uint64_t *offsets) {
+	for (int32_t p = 0; p < el->property_count; p++) {
+		const ply_prop_t *prop = &el->properties[p];
+		if (prop->list_type == 0) continue;
+
+		uint64_t      *curr  = offsets + (size_t)_ply_list_index(el, p) * (el->count + 1);
+		const uint8_t *src   = (const uint8_t *)el->data + prop->offset;
+		uint64_t       total = 0;
+		curr[0] = 0;
+		for (int32_t i = 0; i < el->count; i++) {
+			int32_t ct = _ply_read_count(src, prop->bytes, prop->type);
+			total    += ct;
+			curr[i+1] = total;
+			src      += el->data_stride;
 		}
 	}
 }
 
 ///////////////////////////////////////////
 
-void ply_free(ply_file_t *file) {
-	for (int32_t i = 0; i < file->count; i++) {
-		free(file->elements[i].data);
-		free(file->elements[i].list_data);
-		free(file->elements[i].properties);
+// Each list property reads into a buffer of its own, and then they get
+// packed into a single block, with each property noting where its items
+// start.
+void _ply_lists_pack(ply_element_t *el, const _ply_buffer_t *lists, _ply_buffer_t *out_packed) {
+	size_t  total = 0;
+	int32_t l     = 0;
+	for (int32_t p = 0; p < el->property_count; p++) {
+		if (el->properties[p].list_type == 0) continue;
+		el->properties[p].list_offset = total;
+		total += lists[l++].size;
+	}
+
+	out_packed->size = 0;
+	uint8_t *dest = _ply_buffer_reserve(out_packed, total);
+	for (int32_t i = 0, p = 0; p < el->property_count; p++) {
+		if (el->properties[p].list_type == 0) continue;
+		if (lists[i].size > 0) memcpy(dest + el->properties[p].list_offset, lists[i].data, lists[i].size);
+		i++;
+	}
+	out_packed->size = total;
+}
+
+///////////////////////////////////////////
+
+// Powers of 10 that a double can represent exactly
+const double _ply_pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+///////////////////////////////////////////
+
+// Parses the next number on the line in a single pass, and stores it as
+// the property's type. Integers are read directly. Decimals that fit in 53
+// bits with a small exponent take Clinger's fast path, which is exact and
+// covers the output of nearly every PLY writer. Anything else (long
+// mantissas, huge exponents, nan/inf) goes through strtod.
+void _ply_read_ascii(const char **io_curr, const char *line_end, uint8_t *dest, uint8_t bytes, uint8_t type) {
+	const char *curr = *io_curr;
+	while (curr < line_end && (*curr == ' ' || *curr == '\t')) curr++;
+	const char *start = curr;
+
+	bool negative = false;
+	if (curr < line_end && (*curr == '-' || *curr == '+')) {
+		negative = *curr == '-';
+		curr++;
 	}
-	free(file->elements);
+
+	uint64_t mantissa  = 0;
+	int32_t  digits    = 0;
+	int32_t  exponent  = 0;
+	bool     any       = false;
+	bool     truncated = false;
+	while (curr < line_end && (uint8_t)(*curr - '0') < 10) {
+		if      (digits < 19) { mantissa = mantissa * 10 + (*curr - '0'); digits += mantissa != 0; }
+		else                  { exponent += 1; truncated = true; }
+		any = true;
+		curr++;
+	}
+	if (curr < line_end && *curr == '.') {
+		curr++;
+		while (curr < line_end && (uint8_t)(*curr - '0') < 10) {
+			if (digits < 19) { mantissa = mantissa * 10 + (*curr - '0'); digits += mantissa != 0; exponent -= 1; }
+			else             { truncated = true; }
+			any = true;
+			curr++;
+		}
+	}
+	if (any && curr < line_end && (*curr == 'e' || *curr == 'E')) {
+		curr++;
+		bool    exp_negative = false;
+		int32_t exp          = 0;
+		if (curr < line_end && (*curr == '-' || *curr == '+')) {
+			exp_negative = *curr == '-';
+			curr++;
+		}
+		while (curr < line_end && (uint8_t)(*curr - '0') < 10) {
+			if (exp < 100000) exp = exp * 10 + (*curr - '0');
+			curr++;
+		}
+		exponent += exp_negative ? -exp : exp;
+	}
+	bool clean_end = curr >= line_end || *curr == ' ' || *curr == '\t' || *curr == '\r';
+
+	// Integers are the easy case
+	if (type != ply_prop_decimal && any && clean_end && exponent == 0 && !truncated) {
+		int64_t val = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+		_ply_store_int(dest, bytes, val);
+		*io_curr = curr;
+		return;
+	}
+
+	double val;
+	if (any && clean_end && !truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+		val = (double)mantissa;
+		val = exponent < 0 ? val / _ply_pow10[-exponent] : val * _ply_pow10[exponent];
+		if (negative) val = -val;
+	} else {
+		curr = start;
+		while (curr < line_end && *curr != ' ' && *curr != '\t' && *curr != '\r') curr++;
+		// strtod needs a terminated copy of the whole token, and %f output
+		// of big values can run to hundreds of digits, so long tokens go on
+		// the heap rather than getting cut short.
+		char   stack_word[128];
+		size_t length = (size_t)(curr - start);
+		char  *word   = length < sizeof(stack_word) ? stack_word : (char*)MICRO_PLY_MALLOC(length + 1);
+		memcpy(word, start, length);
+		word[length] = '\0';
+		val = strtod(word, nullptr);
+		if (word != stack_word) MICRO_PLY_FREE(word);
+	}
+	*io_curr = curr;
+
+	if (type == ply_prop_decimal) {
+		if (bytes == 4) { float f = (float)val; memcpy(dest, &f, sizeof(float)); }
+		else            { memcpy(dest, &val, sizeof(double)); }
+	} else {
+		int64_t ival = (int64_t)val;
+		_ply_store_int(dest, bytes, ival);
+	}
+}
+
+///////////////////////////////////////////
+
+// Reads a single row of an element into dest, and adds list items onto
+// the end of the buffer for their list property. Returns where the next
+// row starts, or nullptr if the row runs past the end of the data. ASCII
+// rows end with a newline, unless this is the final chunk of the file.
+const uint8_t *_ply_read_row(const ply_element_t *el, int32_t format, const uint8_t *src, const uint8_t *end, bool final, uint8_t *dest, _ply_buffer_t *lists) {
+	_ply_buffer_t *list = lists;
+	if (format == 0) {
+		const char *line_end = (const char*)memchr(src, '\n', end - src);
+		if (line_end == nullptr) {
+			if (!final || src == end) return nullptr;
+			line_end = (const char*)end;
+		}
+		const char *curr = (const char*)src;
+		for (int32_t p = 0; p < el->property_count; p++) {
+			const ply_prop_t *prop = &el->properties[p];
+			_ply_read_ascii(&curr, line_end, dest + prop->offset, prop->bytes, prop->type);
+			if (prop->list_type == 0) continue;
+
+			int32_t count = _ply_read_count(dest + prop->offset, prop->bytes, prop->type);
+			if (count < 0) return nullptr;
+			uint8_t *items = _ply_buffer_reserve(list, (size_t)count * prop->list_bytes);
+			for (int32_t c = 0; c < count; c++)
+				_ply_read_ascii(&curr, line_end, items + c*prop->list_bytes, prop->list_bytes, prop->list_type);
+			list->size += (size_t)count * prop->list_bytes;
+			list       += 1;
+		}
+		return (const uint8_t*)line_end < end ? (const uint8_t*)line_end + 1 : end;
+	}
+
+	bool swap = _ply_needs_swap(format);
+	for (int32_t p = 0; p < el->property_count; p++) {
+		const ply_prop_t *prop = &el->properties[p];
+		if ((size_t)(end - src) < prop->bytes) return nullptr;
+		memcpy(dest + prop->offset, src, prop->bytes);
+		if (swap) _ply_swap(dest + prop->offset, prop->bytes);
+		src += prop->bytes;
+		if (prop->list_type == 0) continue;
+
+		int32_t count = _ply_read_count(dest + prop->offset, prop->bytes, prop->type);
+		size_t list_size = (size_t)count * prop->list_bytes;
+		if (count < 0 || (size_t)(end - src) < list_size) return nullptr;
+		uint8_t *items = _ply_buffer_reserve(list, list_size);
+		if (list_size > 0) memcpy(items, src, list_size);
+		if (swap) {
+			for (int32_t c = 0; c < count; c++)
+				_ply_swap(items + c*prop->list_bytes, prop->list_bytes);
+		}
+		list->size += list_size;
+		list       += 1;
+		src        += list_size;
+	}
+	return src;
+}
+
+///////////////////////////////////////////
+
+// Walks the rows of an element without keeping anything but the list
+// counts, and builds the element's list offsets from them. That gives the
+// exact size of every list up front, so list storage is only allocated
+// once. Binary rows just hop from count to count, and ASCII rows only
+// parse their counts, skipping over every other word.
+bool _ply_size_lists(const ply_element_t *el, int32_t format, const uint8_t *src, const uint8_t *end, uint64_t *offsets) {
+	int32_t list_count = _ply_list_count(el);
+	int32_t last_list  = 0;
+	bool    swap       = _ply_needs_swap(format);
+	for (int32_t l = 0; l < list_count; l++)
+		offsets[(size_t)l * (el->count + 1)] = 0;
+	for (int32_t p = 0; p < el->property_count; p++)
+		if (el->properties[p].list_type != 0) last_list = p;
+
+	for (int32_t e = 0; e < el->count; e++) {
+		const char *line_end = nullptr;
+		const char *curr     = (const char*)src;
+		if (format == 0) {
+			if (src >= end) return false;
+			line_end = (const char*)memchr(src, '\n', end - src);
+			if (line_end == nullptr) line_end = (const char*)end;
+		}
+
+		uint64_t *list_offsets = offsets;
+		for (int32_t p = 0; p < el->property_count; p++) {
+			const ply_prop_t *prop = &el->properties[p];
+			uint8_t           val[8];
+			if (format == 0) {
+				if (prop->list_type == 0) {
+					while (curr < line_end && (*curr == ' ' || *curr == '\t')) curr++;
+					while (curr < line_end &&  *curr != ' ' && *curr != '\t' && *curr != '\r') curr++;
+					continue;
+				}
+				_ply_read_ascii(&curr, line_end, val, prop->bytes, prop->type);
+			} else {
+				if ((size_t)(end - (const uint8_t*)curr) < prop->bytes) return false;
+				if (prop->list_type == 0) { curr += prop->bytes; continue; }
+				memcpy(val, curr, prop->bytes);
+				if (swap) _ply_swap(val, prop->bytes);
+				curr += prop->bytes;
+			}
+
+			int32_t count = _ply_read_count(val, prop->bytes, prop->type);
+			if (count < 0) return false;
+			list_offsets[e+1] = list_offsets[e] + count;
+			list_offsets     += el->count + 1;
+
+			// ASCII rows have nothing else we need after the last list
+			if (format == 0 && p == last_list) break;
+			if (format == 0) {
+				for (int32_t c = 0; c < count; c++) {
+					while (curr < line_end && (*curr == ' ' || *curr == '\t')) curr++;
+					while (curr < line_end &&  *curr != ' ' && *curr != '\t' && *curr != '\r') curr++;
+				}
+			} else {
+				size_t list_size = (size_t)count * prop->list_bytes;
+				if ((size_t)(end - (const uint8_t*)curr) < list_size) return false;
+				curr += list_size;
+			}
+		}
+		src = format == 0
+			? ((const uint8_t*)line_end < end ? (const uint8_t*)line_end + 1 : end)
+			: (const uint8_t*)curr;
+	}
+	return true;
+}
+
+///////////////////////////////////////////
+
+bool _ply_read_element(ply_element_t *el, int32_t format, int32_t flags, const uint8_t **io_src, const uint8_t *end) {
+	const uint8_t *src       = *io_src;
+	bool           lazy      = (flags & ply_read_lazy) != 0;
+	bool           zero_copy = (flags & ply_read_zero_copy) != 0 || lazy;
+
+	// Lazy elements only need to find where the next element starts. For
+	// binary that's just their size, and little endian ones can skip even
+	// decoding, and be borrowed like zero copy.
+	if (lazy && format == 0 && _ply_list_prop(el) == -1) {
+		for (int32_t e = 0; e < el->count; e++) {
+			if (src >= end) return false;
+			const uint8_t *next = (const uint8_t*)memchr(src, '\n', end - src);
+			src = next ? next + 1 : end;
+		}
+		el->lazy_rows   = *io_src;
+		el->lazy_size   = (size_t)(src - *io_src);
+		el->lazy_format = format;
+		*io_src = src;
+		return true;
+	}
+
+	// Binary rows without lists are fixed size, and already in our own
+	// layout, so they can be copied as a single block, or not at all!
+	if (format != 0 && _ply_list_prop(el) == -1) {
+		size_t size = (size_t)el->data_stride * el->count;
+		if ((size_t)(end - src) < size) return false;
+		*io_src = src + size;
+
+		bool swap = _ply_needs_swap(format);
+		if (zero_copy && !swap) {
+			el->data          = (void*)src;
+			el->data_borrowed = true;
+			return true;
+		}
+		if (lazy) {
+			el->lazy_rows   = src;
+			el->lazy_size   = size;
+			el->lazy_format = format;
+			return true;
+		}
+		el->data = MICRO_PLY_MALLOC(size);
+		memcpy(el->data, src, size);
+		if (swap) {
+			uint8_t *data = (uint8_t*)el->data;
+			for (int32_t e = 0; e < el->count; e++) {
+				for (int32_t p = 0; p < el->property_count; p++)
+					_ply_swap(data + el->properties[p].offset, el->properties[p].bytes);
+				data += el->data_stride;
+			}
+		}
+		return true;
+	}
+
+	el->data = MICRO_PLY_MALLOC((size_t)el->data_stride*el->count);
+	uint8_t       *data       = (uint8_t*)el->data;
+	int32_t        list_count = _ply_list_count(el);
+	_ply_buffer_t *lists      = (_ply_buffer_t*)_ply_calloc(list_count, sizeof(_ply_buffer_t));
+
+	// Lists are sized exactly before reading, and then each list property
+	// reads straight into its own part of list_data. These buffers never
+	// need to grow, and so never realloc.
+	bool result = true;
+	if (list_count > 0) {
+		el->list_offsets = (uint64_t*)MICRO_PLY_MALLOC(sizeof(uint64_t) * (el->count + 1) * list_count);
+		result = _ply_size_lists(el, format, src, end, el->list_offsets);
+	}
+	if (result && list_count > 0) {
+		size_t total = 0;
+		for (int32_t l = 0, p = 0; p < el->property_count; p++) {
+			ply_prop_t *prop = &el->properties[p];
+			if (prop->list_type == 0) continue;
+			prop->list_offset = total;
+			total += el->list_offsets[(size_t)l++ * (el->count + 1) + el->count] * prop->list_bytes;
+		}
+		el->list_data = MICRO_PLY_MALLOC(total > 0 ? total : 1);
+		for (int32_t l = 0, p = 0; p < el->property_count; p++) {
+			const ply_prop_t *prop = &el->properties[p];
+			if (prop->list_type == 0) continue;
+			lists[l].data     = (uint8_t*)el->list_data + prop->list_offset;
+			lists[l].capacity = el->list_offsets[(size_t)l * (el->count + 1) + el->count] * prop->list_bytes;
+			l++;
+		}
+	}
+
+	for (int32_t e = 0; result && e < el->count; e++) {
+		src = _ply_read_row(el, format, src, end, true, data, lists);
+		if (src == nullptr) { result = false; break; }
+		data += el->data_stride;
+	}
+	MICRO_PLY_FREE(lists);
+	*io_src = src;
+	return result;
+}
+
+///////////////////////////////////////////
+
+// Finds the size of the header, or 0 if the data doesn't contain all of it
+// yet.
+size_t _ply_header_size(const char *data, size_t size) {
+	const char *curr = data;
+	const char *end  = data + size;
+	while (curr < end) {
+		const char *next = (const char*)memchr(curr, '\n', end - curr);
+		if (next == nullptr) return 0;
+		if (next - curr >= 10 && memcmp(curr, "end_header", 10) == 0)
+			return (next + 1) - data;
+		curr = next + 1;
+	}
+	return 0;
+}
+
+///////////////////////////////////////////
+
+// Names are hashed once when the header is read, so lookups only compare
+// strings when the hashes already match. This is the same FNV-1a variant
+// as hash_constfnv32_string in ferr_hash.h, so hashes made at compile
+// time with hashc_constfnv32_string work too. That one always runs 64
+// rounds, padding the string with zeros, but xoring in a zero does
+// nothing, so the padding is just the multiply repeated. Here that's one
+// multiply by the prime raised to the number of missing rounds, so a name
+// costs about as much to hash as it does to strcmp.
+uint32_t _ply_hash(const char *str) {
+	uint32_t hash   = 2166136261u;
+	int32_t  rounds = 0;
+	for (; rounds < 64 && str[rounds] != 0; rounds++)
+		hash = (hash ^ (uint8_t)str[rounds]) * 16777619u;
+
+	uint32_t factor = 1;
+	uint32_t prime  = 16777619u;
+	for (int32_t pad = 64 - rounds; pad > 0; pad >>= 1) {
+		if (pad & 1) factor *= prime;
+		prime *= prime;
+	}
+	return hash * factor;
+}
+
+int32_t _ply_find_prop(const ply_element_t *el, const char *name) {
+	uint32_t hash = _ply_hash(name);
+	for (int32_t p = 0; p < el->property_count; p++) {
+		if (el->properties[p].name_hash == hash && strcmp(el->properties[p].name, name) == 0)
+			return p;
+	}
+	return -1;
+}
+
+const ply_element_t *_ply_find_element(const ply_file_t *file, const char *name) {
+	uint32_t hash = _ply_hash(name);
+	for (int32_t i = 0; i < file->count; i++) {
+		if (file->elements[i].name_hash == hash && strcmp(file->elements[i].name, name) == 0)
+			return &file->elements[i];
+	}
+	return nullptr;
+}
+
+///////////////////////////////////////////
+
+bool _ply_read_header(const char *file, ply_file_t *out_file, int32_t *out_format) {
+	// Support function, if string starts with
+	bool (*starts_with)(const char *, const char *) = [](const char *str, const char *prefix) {
+		while (*prefix) {
+			if (*prefix++ != *str++)
+				return false;
+		}
+		return true;
+	};
+	// Support function, gets the following whitespace separated word
+	void (*get_word)(char *start, char *out, size_t out_size) = [](char *start, char *out, size_t out_size) {
+		int count = 0;
+		while (*start != ' ' && *start != '\t' && *start != '\n' && *start != '\r' && *start != '\0' && count < (out_size - 1)) {
+			out[count] = *start++;
+			count++;
+		}
+		out[count] = '\0';
+	};
+	void (*type_info)(const char *, uint8_t *, uint8_t *) = [](const char *str, uint8_t *type, uint8_t *bytes) {
+		if      (strcmp(str, "char"  ) == 0) { *bytes = 1; *type = ply_prop_int;     }
+		else if (strcmp(str, "uchar" ) == 0) { *bytes = 1; *type = ply_prop_uint;    }
+		else if (strcmp(str, "short" ) == 0) { *bytes = 2; *type = ply_prop_int;     }
+		else if (strcmp(str, "ushort") == 0) { *bytes = 2; *type = ply_prop_uint;    }
+		else if (strcmp(str, "int"   ) == 0) { *bytes = 4; *type = ply_prop_int;     }
+		else if (strcmp(str, "uint"  ) == 0) { *bytes = 4; *type = ply_prop_uint;    }
+		else if (strcmp(str, "float" ) == 0) { *bytes = 4; *type = ply_prop_decimal; }
+		else if (strcmp(str, "double") == 0) { *bytes = 8; *type = ply_prop_decimal; }
+	};
+
+	// Check file signature
+	if (!starts_with(file, "ply"))
+		return false;
+
+	// File data
+	int32_t format     = 0;
+	out_file->count    = 0;
+	out_file->elements = nullptr;
+
+	// Read the header
+	char *line = strchr((char*)file, '\n');
+	char  word[128];
+	while(true) {
+		if (!line) return false;
+		line += 1;
+
+		if        (starts_with(line, "format ")) {
+			get_word(line + sizeof("format"), word, sizeof(word));
+			if      (strcmp(word, "ascii"               ) == 0) format = 0;
+			else if (strcmp(word, "binary_little_endian") == 0) format = 1;
+			else if (strcmp(word, "binary_big_endian"   ) == 0) format = 2;
+		} else if (starts_with(line, "comment ")) {
+		} else if (starts_with(line, "element ")) {
+			ply_element_t el = {};
+			get_word(line + sizeof("element"), el.name, sizeof(el.name));
+			get_word(line + sizeof("element ") + strlen(el.name), word, sizeof(word));
+			el.count     = atoi(word);
+			el.name_hash = _ply_hash(el.name);
+
+			out_file->count   += 1;
+			out_file->elements = (ply_element_t*)MICRO_PLY_REALLOC(out_file->elements, sizeof(ply_element_t) * (out_file->count));
+			out_file->elements[out_file->count - 1] = el;
+		} else if (starts_with(line, "property ")) {
+			ply_prop_t     prop = {};
+			get_word(line + sizeof("property"), word, sizeof(word));
+			
+			if (strcmp(word, "list"  ) == 0) {
+				size_t off = sizeof("property ") + strlen(word);
+				get_word(line + off, word, sizeof(word));
+				type_info(word, &prop.type, &prop.bytes);
+				off += strlen(word) + 1;
+				get_word(line + off, word, sizeof(word));
+				type_info(word, &prop.list_type, &prop.list_bytes);
+				off += strlen(word) + 1;
+				get_word(line + off, prop.name, sizeof(prop.name));
+			} else { 
+				type_info(word, &prop.type, &prop.bytes);
+				get_word(line + sizeof("property ") + strlen(word), prop.name, sizeof(prop.name));
+			}
+
+			if (out_file->count == 0) return false;
+			ply_element_t *el   = &out_file->elements[out_file->count-1];
+			prop.name_hash = _ply_hash(prop.name);
+			prop.offset    = el->data_stride;
+			el->data_stride    += prop.bytes;
+			el->property_count += 1;
+			el->properties      = (ply_prop_t*)MICRO_PLY_REALLOC(el->properties, sizeof(ply_prop_t) * el->property_count);
+			el->properties[el->property_count-1] = prop;
+		} else if (starts_with(line, "end_header")) {
+			break;
+		}
+		line = strchr(line, '\n');
+	}
+	*out_format = format;
+	return true;
+}
+
+///////////////////////////////////////////
+
+typedef struct _ply_ascii_job_t {
+	ply_file_t     *file;
+	const uint8_t  *end;
+	const uint8_t **chunk_starts;   // job_count+1 entries
+	int64_t        *chunk_lines;    // Line count of each chunk, then the index of its first line
+	int64_t        *element_lines;  // Index of each element's first line
+	const uint8_t **element_starts;
+	bool           *failed;
+} _ply_ascii_job_t;
+
+void _ply_job_count_lines(void *job_data, int32_t i) {
+	_ply_ascii_job_t *job  = (_ply_ascii_job_t*)job_data;
+	const uint8_t    *curr = job->chunk_starts[i];
+	const uint8_t    *end  = job->chunk_starts[i+1];
+	int64_t           lines = 0;
+	while (curr < end && (curr = (const uint8_t*)memchr(curr, '\n', end - curr)) != nullptr) {
+		lines += 1;
+		curr  += 1;
+	}
+	job->chunk_lines[i] = lines;
+}
+
+void _ply_job_parse_lines(void *job_data, int32_t i) {
+	_ply_ascii_job_t *job       = (_ply_ascii_job_t*)job_data;
+	const uint8_t    *curr      = job->chunk_starts[i];
+	const uint8_t    *chunk_end = job->chunk_starts[i+1];
+	int64_t           line      = job->chunk_lines[i];
+	int32_t           e         = -1;
+	int32_t           list_prop = -1;
+	ply_element_t    *el        = nullptr;
+	while (curr < chunk_end) {
+		if (el == nullptr || line >= job->element_lines[e] + el->count) {
+			do { e += 1; } while (e < job->file->count && line >= job->element_lines[e] + job->file->elements[e].count);
+			if (e >= job->file->count) break;
+			el        = &job->file->elements[e];
+			list_prop = _ply_list_prop(el);
+		}
+		if (line == job->element_lines[e])
+			job->element_starts[e] = curr;
+
+		// List rows can't be placed until we know the size of the lists
+		// before them, so those get read afterwards.
+		if (list_prop != -1) {
+			const uint8_t *next = (const uint8_t*)memchr(curr, '\n', chunk_end - curr);
+			curr = next ? next + 1 : chunk_end;
+		} else {
+			curr = _ply_read_row(el, 0, curr, job->end, true, (uint8_t*)el->data + (line - job->element_lines[e]) * el->data_stride, nullptr);
+			if (curr == nullptr) {
+				job->failed[i] = true;
+				break;
+			}
+		}
+		line += 1;
+	}
+}
+
+///////////////////////////////////////////
+
+// ASCII rows are one per line, so if we know how many lines come before
+// each chunk of the file, we know exactly which row each line belongs to.
+// Lines are counted in parallel, then added up, and then each chunk parses
+// its own rows right into place.
+bool _ply_read_ascii_parallel(ply_file_t *file, const uint8_t *body, const uint8_t *end, const ply_read_opts_t *opts) {
+	int32_t          job_count = opts->job_count > 0 ? opts->job_count : 64;
+	size_t           size      = end - body;
+	_ply_ascii_job_t job       = {};
+	job.file           = file;
+	job.end            = end;
+	job.chunk_starts   = (const uint8_t**)MICRO_PLY_MALLOC(sizeof(uint8_t*) * (job_count + 1));
+	job.chunk_lines    = (int64_t       *)MICRO_PLY_MALLOC(sizeof(int64_t ) *  job_count);
+	job.element_lines  = (int64_t       *)MICRO_PLY_MALLOC(sizeof(int64_t ) *  file->count);
+	job.element_starts = (const uint8_t**)_ply_calloc(file->count, sizeof(uint8_t*));
+	job.failed         = (bool          *)_ply_calloc(job_count, sizeof(bool));
+
+	// Split into chunks that start right after a newline
+	job.chunk_starts[0]         = body;
+	job.chunk_starts[job_count] = end;
+	for (int32_t i = 1; i < job_count; i++) {
+		const uint8_t *start = body + (size * i) / job_count;
+		const uint8_t *next  = start < end ? (const uint8_t*)memchr(start, '\n', end - start) : nullptr;
+		start = next ? next + 1 : end;
+		job.chunk_starts[i] = start > job.chunk_starts[i-1] ? start : job.chunk_starts[i-1];
+	}
+	opts->dispatch(opts->dispatch_data, _ply_job_count_lines, &job, job_count);
+
+	// Prefix sum the line counts, and check the file has enough of them
+	int64_t lines = 0;
+	for (int32_t i = 0; i < job_count; i++) {
+		int64_t count = job.chunk_lines[i];
+		job.chunk_lines[i] = lines;
+		lines += count;
+	}
+	if (size > 0 && end[-1] != '\n') lines += 1;
+	int64_t rows = 0;
+	for (int32_t e = 0; e < file->count; e++) {
+		job.element_lines[e] = rows;
+		rows += file->elements[e].count;
+		if (_ply_list_prop(&file->elements[e]) == -1)
+			file->elements[e].data = MICRO_PLY_MALLOC((size_t)file->elements[e].data_stride * file->elements[e].count);
+	}
+
+	bool result = rows <= lines;
+	if (result) {
+		opts->dispatch(opts->dispatch_data, _ply_job_parse_lines, &job, job_count);
+		for (int32_t i = 0; i < job_count; i++)
+			result = result && !job.failed[i];
+	}
+
+	// Now the elements with lists
+	for (int32_t e = 0; result && e < file->count; e++) {
+		if (_ply_list_prop(&file->elements[e]) == -1) continue;
+		const uint8_t *src = job.element_starts[e] ? job.element_starts[e] : end;
+		result = _ply_read_element(&file->elements[e], 0, 0, &src, end);
+	}
+
+	MICRO_PLY_FREE(job.chunk_starts);
+	MICRO_PLY_FREE(job.chunk_lines);
+	MICRO_PLY_FREE(job.element_lines);
+	MICRO_PLY_FREE(job.element_starts);
+	MICRO_PLY_FREE(job.failed);
+	return result;
+}
+
+///////////////////////////////////////////
+
+bool ply_read(const void *file_data, size_t data_size, ply_file_t *out_file) {
+	return ply_read_ex(file_data, data_size, nullptr, out_file);
+}
+
+///////////////////////////////////////////
+
+bool ply_read_ex(const void *file_data, size_t data_size, const ply_read_opts_t *opts, ply_file_t *out_file) {
+	*out_file = {};
+
+	// The header is plain text, terminated by an end_header line
+	int32_t format      = 0;
+	size_t  header_size = _ply_header_size((const char*)file_data, data_size);
+	if (header_size == 0 || !_ply_read_header((const char*)file_data, out_file, &format)) {
+		ply_free(out_file);
+		return false;
+	}
+
+	// Parse the data
+	const uint8_t *src       = (const uint8_t*)file_data + header_size;
+	const uint8_t *end       = (const uint8_t*)file_data + data_size;
+	int32_t        flags     = opts != nullptr ? opts->flags : 0;
+	if (format == 0 && opts != nullptr && opts->dispatch != nullptr && !(flags & ply_read_lazy)) {
+		if (!_ply_read_ascii_parallel(out_file, src, end, opts)) {
+			ply_free(out_file);
+			return false;
+		}
+		return true;
+	}
+	for (int32_t i = 0; i < out_file->count; i++) {
+		if (!_ply_read_element(&out_file->elements[i], format, flags, &src, end)) {
+			ply_free(out_file);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////
+
+#ifndef MICRO_PLY_NO_FILE
+bool ply_read_file(const char *filename, const ply_read_opts_t *opts, ply_file_t *out_file) {
+	*out_file = {};
+	void  *data   = nullptr;
+	size_t size   = 0;
+	bool   mapped = false;
+
+#ifdef _MICRO_PLY_MMAP
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) { close(fd); return false; }
+	size = (size_t)info.st_size;
+	data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+	madvise(data, size, MADV_SEQUENTIAL);
+	mapped = true;
+#else
+	FILE *fp = fopen(filename, "rb");
+	if (fp == nullptr) return false;
+	// long is 32 bits on Windows, so ftell can't see past 2GB there
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	int64_t length = _ftelli64(fp);
+#else
+	fseek(fp, 0L, SEEK_END);
+	int64_t length = ftell(fp);
+#endif
+	rewind(fp);
+	if (length <= 0 || (uint64_t)length > (uint64_t)SIZE_MAX) { fclose(fp); return false; }
+	size = (size_t)length;
+	data = MICRO_PLY_MALLOC(size);
+	// Read in chunks, since some CRTs don't cope with multi-GB freads
+	bool read = data != nullptr;
+	for (size_t at = 0; read && at < size; ) {
+		size_t chunk = size - at < ((size_t)1 << 30) ? size - at : ((size_t)1 << 30);
+		read = fread((uint8_t*)data + at, 1, chunk, fp) == chunk;
+		at  += chunk;
+	}
+	fclose(fp);
+	if (!read) { MICRO_PLY_FREE(data); return false; }
+#endif
+
+	if (!ply_read_ex(data, size, opts, out_file)) {
+#ifdef _MICRO_PLY_MMAP
+		munmap(data, size);
+#else
+		MICRO_PLY_FREE(data);
+#endif
+		return false;
+	}
+	out_file->source        = data;
+	out_file->source_size   = size;
+	out_file->source_mapped = mapped;
+	return true;
+}
+#endif
+
+///////////////////////////////////////////
+
+// Finds the list property a map wants triangulated, or -1 if it's a
+// regular row by row conversion. That's when the first entry names a list
+// property, or when an element with lists doesn't have any of the names
+// in the map, so face lists called something other than PLY_PROP_INDICES
+// still work.
+int32_t _ply_convert_list(const ply_element_t *el, const ply_map_t *to_format, int32_t format_count) {
+	int32_t first_list = _ply_list_prop(el);
+	if (first_list == -1 || format_count == 0) return -1;
+
+	for (int32_t f = 0; f < format_count; f++) {
+		int32_t p = _ply_find_prop(el, to_format[f].name);
+		if (p != -1) return f == 0 && el->properties[p].list_type != 0 ? p : -1;
+	}
+	return first_list;
+}
+
+///////////////////////////////////////////
+
+// Counts the triangles that fanning out rows [start, end) of a list makes
+int64_t _ply_count_tris(const ply_element_t *el, int32_t list_prop, int32_t start, int32_t end) {
+	const uint64_t *offsets = el->list_offsets + (size_t)_ply_list_index(el, list_prop) * (el->count + 1);
+	int64_t         tris    = 0;
+	for (int32_t i = start; i < end; i++) {
+		int64_t ct = (int64_t)(offsets[i+1] - offsets[i]);
+		if (ct > 2) tris += ct-2;
+	}
+	return tris;
+}
+
+///////////////////////////////////////////
+
+// How many items ply_convert will produce for this element. Lists get
+// triangulated, so for those this is their index count.
+int32_t _ply_convert_count(const ply_element_t *el, const ply_map_t *to_format, int32_t format_count) {
+	int32_t list_prop = _ply_convert_list(el, to_format, format_count);
+	if (list_prop == -1)
+		return el->count;
+
+	return (int32_t)_ply_count_tris(el, list_prop, 0, el->count) * 3;
+}
+
+///////////////////////////////////////////
+
+// A conversion plan is the map resolved against a particular element, so
+// the per-value work of ply_convert is just running a kernel.
+typedef struct _ply_op_t {
+	_ply_kernel_fn kernel;
+	const uint8_t *src;        // Start of the column, or the default value. Null for lazy elements.
+	int32_t        src_stride; // 0 for default values
+	int32_t        src_offset; // Where the column is in a row, -1 for default values
+	int32_t        src_bytes;
+	uint8_t       *dest;       // Start of the destination column
+	int32_t        dest_stride;
+	int32_t        size;       // Destination bytes
+} _ply_op_t;
+
+int32_t _ply_plan(const ply_element_t *el, const ply_map_t *to_format, int32_t format_count, uint8_t *dest, int32_t dest_stride, _ply_op_t *out_ops) {
+	int32_t count = 0;
+	for (int32_t i = 0; i < format_count; i++) {
+		const ply_map_t  *map  = &to_format[i];
+		int32_t           p    = _ply_find_prop(el, map->name);
+		const ply_prop_t *prop = p != -1 ? &el->properties[p] : nullptr;
+
+		_ply_op_t op = {};
+		op.dest        = dest + map->to_offset;
+		op.dest_stride = dest_stride;
+		op.size        = map->to_size;
+		if (prop) op.kernel = _ply_kernel_for(map->to_size, map->to_type, prop->bytes, prop->type);
+		if (op.kernel) {
+			op.src        = el->data ? (const uint8_t*)el->data + prop->offset : nullptr;
+			op.src_stride = el->data_stride;
+			op.src_offset = prop->offset;
+			op.src_bytes  = prop->bytes;
+		} else {
+			op.kernel     = _ply_kernel_copy;
+			op.src        = (const uint8_t*)map->default_val;
+			op.src_stride = 0;
+			op.src_offset = -1;
+		}
+
+		// Straight copies that sit right next to each other on both sides
+		// can be done as one bigger copy.
+		_ply_op_t *prev = count > 0 ? &out_ops[count-1] : nullptr;
+		if (prev && prev->kernel == _ply_kernel_copy && op.kernel == _ply_kernel_copy &&
+			prev->src_offset != -1 && op.src_offset != -1 &&
+			prev->src_offset + prev->src_bytes == op.src_offset &&
+			prev->dest       + prev->size      == op.dest) {
+			prev->size      += op.size;
+			prev->src_bytes += op.src_bytes;
+		} else {
+			out_ops[count++] = op;
+		}
+	}
+	return count;
+}
+
+///////////////////////////////////////////
+
+// Lazy elements are still sitting in the source, so this decodes just
+// the columns a plan reads from the next few rows, into scratch rows
+// laid out like el->data. ASCII rows skip over the words they don't need,
+// and stop parsing after the last column they do.
+const uint8_t *_ply_lazy_decode(const ply_element_t *el, const uint8_t *columns, int32_t last_column, const uint8_t *src, int32_t rows, uint8_t *dest) {
+	const uint8_t *end = (const uint8_t*)el->lazy_rows + el->lazy_size;
+	for (int32_t r = 0; r < rows; r++) {
+		if (el->lazy_format == 0) {
+			const char *line_end = (const char*)memchr(src, '\n', end - src);
+			if (line_end == nullptr) line_end = (const char*)end;
+			const char *curr = (const char*)src;
+			for (int32_t p = 0; p <= last_column; p++) {
+				const ply_prop_t *prop = &el->properties[p];
+				if (columns[p]) {
+					_ply_read_ascii(&curr, line_end, dest + prop->offset, prop->bytes, prop->type);
+				} else {
+					while (curr < line_end && (*curr == ' ' || *curr == '\t')) curr++;
+					while (curr < line_end &&  *curr != ' ' && *curr != '\t' && *curr != '\r') curr++;
+				}
+			}
+			src = (const uint8_t*)line_end < end ? (const uint8_t*)line_end + 1 : end;
+		} else {
+			bool swap = _ply_needs_swap(el->lazy_format);
+			for (int32_t p = 0; p <= last_column; p++) {
+				const ply_prop_t *prop = &el->properties[p];
+				if (!columns[p]) continue;
+				memcpy(dest + prop->offset, src + prop->offset, prop->bytes);
+				if (swap) _ply_swap(dest + prop->offset, prop->bytes);
+			}
+			src += el->data_stride;
+		}
+		dest += el->data_stride;
+	}
+	return src;
+}
+
+///////////////////////////////////////////
+
+// Runs the plan over blocks of rows, so the destination rows for a block
+// stay in cache while each kernel takes its pass over them. A plan can
+// hold ops for several destinations, and then each block of source rows
+// gets read while it's still in cache too. on_block is optional, and gets
+// each block of finished rows while they're still in cache.
+typedef void (*_ply_block_fn)(void *block_data, int32_t start, int32_t rows);
+
+void _ply_plan_run(const ply_element_t *el, const _ply_op_t *ops, int32_t op_count, _ply_block_fn on_block, void *block_data) {
+	const int32_t block = 256;
+	if (el->lazy_rows == nullptr) {
+		for (int32_t start = 0; start < el->count; start += block) {
+			int32_t rows = el->count - start < block ? el->count - start : block;
+			for (int32_t o = 0; o < op_count; o++) {
+				const _ply_op_t *op = &ops[o];
+				op->kernel(
+					op->dest + (size_t)start * op->dest_stride, op->dest_stride,
+					op->src  + (size_t)start * op->src_stride,  op->src_stride,
+					rows, op->size);
+			}
+			if (on_block) on_block(block_data, start, rows);
+		}
+		return;
+	}
+
+	// Find which columns the plan actually reads
+	uint8_t *columns     = (uint8_t*)_ply_calloc(el->property_count, sizeof(uint8_t));
+	int32_t  last_column = -1;
+	for (int32_t o = 0; o < op_count; o++) {
+		if (ops[o].src_offset == -1) continue;
+		for (int32_t p = 0; p < el->property_count; p++) {
+			const ply_prop_t *prop = &el->properties[p];
+			if (prop->offset < ops[o].src_offset || prop->offset >= ops[o].src_offset + ops[o].src_bytes) continue;
+			columns[p] = 1;
+			if (p > last_column) last_column = p;
+		}
+	}
+
+	uint8_t       *scratch = (uint8_t*)MICRO_PLY_MALLOC((size_t)el->data_stride * block);
+	const uint8_t *src     = (const uint8_t*)el->lazy_rows;
+	for (int32_t start = 0; start < el->count; start += block) {
+		int32_t rows = el->count - start < block ? el->count - start : block;
+		src = _ply_lazy_decode(el, columns, last_column, src, rows, scratch);
+		for (int32_t o = 0; o < op_count; o++) {
+			const _ply_op_t *op = &ops[o];
+			op->kernel(
+				op->dest + (size_t)start * op->dest_stride, op->dest_stride,
+				op->src_offset != -1 ? scratch + op->src_offset : op->src, op->src_stride,
+				rows, op->size);
+		}
+		if (on_block) on_block(block_data, start, rows);
+	}
+	MICRO_PLY_FREE(scratch);
+	MICRO_PLY_FREE(columns);
+}
+
+///////////////////////////////////////////
+
+// Fan triangulates rows [start, end) of a list into dest, as three
+// columns: the first index of each triangle is always index 0, then x+1
+// and x+2.
+void _ply_triangulate(const ply_element_t *el, int32_t list_prop, const ply_map_t *to_format, int32_t format_stride, uint8_t *dest, int32_t start, int32_t end) {
+	uint8_t src_ind_size = el->properties[list_prop].list_bytes;
+	uint8_t src_ind_type = el->properties[list_prop].list_type;
+
+	_ply_kernel_fn kernel = _ply_kernel_for(to_format[0].to_size, to_format[0].to_type, src_ind_size, src_ind_type);
+	if (kernel == nullptr) return;
+
+	const uint64_t *offsets  = el->list_offsets + (size_t)_ply_list_index(el, list_prop) * (el->count + 1);
+	const uint8_t  *src_list = (const uint8_t*)el->list_data + el->properties[list_prop].list_offset;
+	for (int32_t i = start; i < end; i++) {
+		int32_t ct = (int32_t)(offsets[i+1] - offsets[i]);
+		if (ct <= 2) continue;
+
+		const uint8_t *src_ind = src_list + offsets[i] * src_ind_size;
+		kernel(dest,                   format_stride*3, src_ind,                  0,            ct-2, to_format[0].to_size);
+		kernel(dest + format_stride,   format_stride*3, src_ind + src_ind_size,   src_ind_size, ct-2, to_format[0].to_size);
+		kernel(dest + format_stride*2, format_stride*3, src_ind + src_ind_size*2, src_ind_size, ct-2, to_format[0].to_size);
+		dest += format_stride * (ct-2)*3;
+	}
+}
+
+///////////////////////////////////////////
+
+// Parallel triangulation splits the faces into ranges, counts the
+// triangles in each, then prefix sums those to find where each range
+// writes its indices.
+typedef struct _ply_tri_job_t {
+	const ply_element_t *el;
+	const ply_map_t     *to_format;
+	int32_t              list_prop;
+	int32_t              format_stride;
+	int32_t              job_count;
+	int64_t             *job_tris;  // Triangle counts for each job, then where each job starts
+	uint8_t             *out;
+} _ply_tri_job_t;
+
+void _ply_job_count_tris(void *job_data, int32_t i) {
+	_ply_tri_job_t *job   = (_ply_tri_job_t*)job_data;
+	int32_t         start = (int32_t)(((int64_t)job->el->count *  i     ) / job->job_count);
+	int32_t         end   = (int32_t)(((int64_t)job->el->count * (i + 1)) / job->job_count);
+	job->job_tris[i] = _ply_count_tris(job->el, job->list_prop, start, end);
+}
+
+void _ply_job_triangulate(void *job_data, int32_t i) {
+	_ply_tri_job_t *job   = (_ply_tri_job_t*)job_data;
+	int32_t         start = (int32_t)(((int64_t)job->el->count *  i     ) / job->job_count);
+	int32_t         end   = (int32_t)(((int64_t)job->el->count * (i + 1)) / job->job_count);
+	_ply_triangulate(job->el, job->list_prop, job->to_format, job->format_stride, job->out + job->job_tris[i] * 3 * job->format_stride, start, end);
+}
+
+///////////////////////////////////////////
+
+void _ply_convert_element(const ply_element_t *elements, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, void *out_data) {
+	int32_t list_prop = _ply_convert_list(elements, to_format, format_count);
+	if (list_prop == -1) {
+		_ply_op_t *ops      = (_ply_op_t*)MICRO_PLY_MALLOC(sizeof(_ply_op_t) * format_count);
+		int32_t    op_count = _ply_plan(elements, to_format, format_count, (uint8_t*)out_data, format_stride, ops);
+		_ply_plan_run(elements, ops, op_count, nullptr, nullptr);
+		MICRO_PLY_FREE(ops);
+	} else {
+		_ply_triangulate(elements, list_prop, to_format, format_stride, (uint8_t*)out_data, 0, elements->count);
+	}
+}
+
+///////////////////////////////////////////
+
+void ply_convert(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, void **out_data, int32_t *out_count) {
+	ply_convert_ex(file, element_name, to_format, format_count, format_stride, nullptr, out_data, out_count);
+}
+
+///////////////////////////////////////////
+
+// Converts into *dest when there's room for the result there, or when
+// *dest is null, allocates a buffer of the right size for it.
+bool _ply_convert_to(const ply_element_t *el, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, const ply_convert_opts_t *opts, void **dest, int32_t dest_capacity, int32_t *out_count) {
+	int32_t list_prop = _ply_convert_list(el, to_format, format_count);
+	if (list_prop == -1 || opts == nullptr || opts->dispatch == nullptr) {
+		*out_count = _ply_convert_count(el, to_format, format_count);
+		if      (*dest == nullptr)            *dest = MICRO_PLY_MALLOC((size_t)*out_count * format_stride);
+		else if (*out_count > dest_capacity) return false;
+		_ply_convert_element(el, to_format, format_count, format_stride, *dest);
+		return true;
+	}
+
+	_ply_tri_job_t job = {};
+	job.el            = el;
+	job.to_format     = to_format;
+	job.list_prop     = list_prop;
+	job.format_stride = format_stride;
+	job.job_count     = opts->job_count > 0 ? opts->job_count : 64;
+	job.job_tris      = (int64_t*)MICRO_PLY_MALLOC(sizeof(int64_t) * job.job_count);
+	opts->dispatch(opts->dispatch_data, _ply_job_count_tris, &job, job.job_count);
+
+	int64_t tris = 0;
+	for (int32_t i = 0; i < job.job_count; i++) {
+		int64_t count = job.job_tris[i];
+		job.job_tris[i] = tris;
+		tris += count;
+	}
+	*out_count = (int32_t)(tris * 3);
+
+	bool result = true;
+	if      (*dest == nullptr)            *dest  = MICRO_PLY_MALLOC((size_t)*out_count * format_stride);
+	else if (*out_count > dest_capacity) result = false;
+	if (result) {
+		job.out = (uint8_t*)*dest;
+		opts->dispatch(opts->dispatch_data, _ply_job_triangulate, &job, job.job_count);
+	}
+	MICRO_PLY_FREE(job.job_tris);
+	return result;
+}
+
+///////////////////////////////////////////
+
+void ply_convert_ex(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, const ply_convert_opts_t *opts, void **out_data, int32_t *out_count) {
+	*out_data  = nullptr;
+	*out_count = 0;
+
+	// Find the elements we want to convert by name
+	const ply_element_t *elements = _ply_find_element(file, element_name);
+	if (elements == nullptr)
+		return;
+
+	_ply_convert_to(elements, to_format, format_count, format_stride, opts, out_data, 0, out_count);
+}
+
+///////////////////////////////////////////
+
+void ply_convert_soa(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count, void **out_arrays, int32_t *out_count) {
+	for (int32_t i = 0; i < format_count; i++)
+		out_arrays[i] = nullptr;
+	*out_count = 0;
+	const ply_element_t *elements = _ply_find_element(file, element_name);
+	if (elements == nullptr || format_count == 0)
+		return;
+
+	// Triangulated lists only ever make the one index array
+	*out_count = _ply_convert_count(elements, to_format, format_count);
+	if (_ply_convert_list(elements, to_format, format_count) != -1) {
+		out_arrays[0] = MICRO_PLY_MALLOC((size_t)*out_count * to_format[0].to_size);
+		_ply_convert_element(elements, to_format, 1, to_format[0].to_size, out_arrays[0]);
+		return;
+	}
+
+	// Each entry is its own column, with a stride of just its own size.
+	// They all share one plan, so the rows are still only read once.
+	_ply_op_t *ops      = (_ply_op_t*)MICRO_PLY_MALLOC(sizeof(_ply_op_t) * format_count);
+	int32_t    op_count = 0;
+	for (int32_t i = 0; i < format_count; i++) {
+		ply_map_t column = to_format[i];
+		column.to_offset = 0;
+		out_arrays[i] = MICRO_PLY_MALLOC((size_t)*out_count * column.to_size);
+		op_count += _ply_plan(elements, &column, 1, (uint8_t*)out_arrays[i], column.to_size, &ops[op_count]);
+	}
+	_ply_plan_run(elements, ops, op_count, nullptr, nullptr);
+	MICRO_PLY_FREE(ops);
+}
+
+///////////////////////////////////////////
+
+// Welding hashes each block of converted vertices while it's still in
+// cache. The table holds indices of unique vertices, which get packed
+// down towards the front of the output as they're found. Only the bytes
+// the map writes are compared, so struct padding doesn't matter.
+typedef struct _ply_weld_t {
+	uint8_t *verts;
+	int32_t  stride;
+	int32_t *ranges;      // Pairs of offset and size, for the bytes the map writes
+	int32_t  range_count;
+	int32_t *table;       // -1 for empty slots
+	uint32_t table_mask;
+	int32_t *remap;       // Unique vertex for each original vertex
+	int32_t  unique;
+} _ply_weld_t;
+
+uint64_t _ply_weld_hash(const _ply_weld_t *weld, const uint8_t *vert) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (int32_t r = 0; r < weld->range_count; r++) {
+		const uint8_t *bytes = vert + weld->ranges[r*2];
+		for (int32_t i = 0; i < weld->ranges[r*2+1]; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool _ply_weld_equal(const _ply_weld_t *weld, const uint8_t *a, const uint8_t *b) {
+	for (int32_t r = 0; r < weld->range_count; r++) {
+		if (memcmp(a + weld->ranges[r*2], b + weld->ranges[r*2], weld->ranges[r*2+1]) != 0)
+			return false;
+	}
+	return true;
+}
+
+void _ply_weld_block(void *block_data, int32_t start, int32_t rows) {
+	_ply_weld_t *weld = (_ply_weld_t*)block_data;
+	for (int32_t i = start; i < start + rows; i++) {
+		uint8_t *vert = weld->verts + (size_t)i * weld->stride;
+		uint32_t slot = (uint32_t)_ply_weld_hash(weld, vert) & weld->table_mask;
+		while (weld->table[slot] != -1 && !_ply_weld_equal(weld, weld->verts + (size_t)weld->table[slot] * weld->stride, vert))
+			slot = (slot + 1) & weld->table_mask;
+
+		if (weld->table[slot] == -1) {
+			weld->table[slot] = weld->unique;
+			if (weld->unique != i) memcpy(weld->verts + (size_t)weld->unique * weld->stride, vert, weld->stride);
+			weld->unique += 1;
+		}
+		weld->remap[i] = weld->table[slot];
+	}
+}
+
+///////////////////////////////////////////
+
+bool ply_convert_welded(const ply_file_t *file, const char *vert_element, const ply_map_t *vert_format, int32_t vert_format_count, int32_t vert_stride, const char *ind_element, const ply_map_t *ind_format, int32_t ind_format_count, int32_t ind_stride, void **out_verts, int32_t *out_vert_count, void **out_inds, int32_t *out_ind_count) {
+	*out_verts      = nullptr;
+	*out_vert_count = 0;
+	*out_inds       = nullptr;
+	*out_ind_count  = 0;
+	const ply_element_t *verts = _ply_find_element(file, vert_element);
+	const ply_element_t *inds  = _ply_find_element(file, ind_element);
+	if (verts == nullptr || inds == nullptr || ind_format_count == 0 || _ply_convert_list(verts, vert_format, vert_format_count) != -1)
+		return false;
+
+	// Which bytes of the vertex the map writes, with neighbors merged
+	_ply_weld_t weld = {};
+	weld.stride = vert_stride;
+	weld.ranges = (int32_t*)MICRO_PLY_MALLOC(sizeof(int32_t) * 2 * vert_format_count);
+	for (int32_t f = 0; f < vert_format_count; f++) {
+		int32_t *prev = weld.range_count > 0 ? &weld.ranges[(weld.range_count-1)*2] : nullptr;
+		if (prev && prev[0] + prev[1] == vert_format[f].to_offset) {
+			prev[1] += vert_format[f].to_size;
+		} else {
+			weld.ranges[weld.range_count*2  ] = vert_format[f].to_offset;
+			weld.ranges[weld.range_count*2+1] = vert_format[f].to_size;
+			weld.range_count += 1;
+		}
+	}
+
+	uint32_t table_size = 16;
+	while (table_size < (uint32_t)verts->count * 2) table_size *= 2;
+	weld.verts      = (uint8_t*)MICRO_PLY_MALLOC((size_t)verts->count * vert_stride);
+	weld.table      = (int32_t*)MICRO_PLY_MALLOC(sizeof(int32_t) * table_size);
+	weld.table_mask = table_size - 1;
+	weld.remap      = (int32_t*)MICRO_PLY_MALLOC(sizeof(int32_t) * verts->count);
+	memset(weld.table, 0xFF, sizeof(int32_t) * table_size);
+
+	_ply_op_t *ops      = (_ply_op_t*)MICRO_PLY_MALLOC(sizeof(_ply_op_t) * vert_format_count);
+	int32_t    op_count = _ply_plan(verts, vert_format, vert_format_count, weld.verts, vert_stride, ops);
+	_ply_plan_run(verts, ops, op_count, _ply_weld_block, &weld);
+	MICRO_PLY_FREE(ops);
+	MICRO_PLY_FREE(weld.table);
+	MICRO_PLY_FREE(weld.ranges);
+
+	// Indices convert as usual, then go through the remap table as 64 bit
+	// ints. Indices that don't point at a vertex are left alone.
+	void   *ind_data  = nullptr;
+	int32_t ind_count = 0;
+	_ply_convert_to(inds, ind_format, ind_format_count, ind_stride, nullptr, &ind_data, 0, &ind_count);
+
+	const ply_map_t *ind_map  = &ind_format[0];
+	_ply_kernel_fn   to_int   = _ply_kernel_for(sizeof(int64_t), ply_prop_int, ind_map->to_size, ind_map->to_type);
+	_ply_kernel_fn   from_int = _ply_kernel_for(ind_map->to_size, ind_map->to_type, sizeof(int64_t), ply_prop_int);
+	uint8_t         *ind_col  = (uint8_t*)ind_data + ind_map->to_offset;
+	if (to_int && from_int) {
+		int64_t values[256];
+		for (int32_t start = 0; start < ind_count; start += 256) {
+			int32_t count = ind_count - start < 256 ? ind_count - start : 256;
+			to_int(  (uint8_t*)values, sizeof(int64_t), ind_col + (size_t)start * ind_stride, ind_stride, count, sizeof(int64_t));
+			for (int32_t i = 0; i < count; i++) {
+				if (values[i] >= 0 && values[i] < verts->count)
+					values[i] = weld.remap[values[i]];
+			}
+			from_int(ind_col + (size_t)start * ind_stride, ind_stride, (uint8_t*)values, sizeof(int64_t), count, ind_map->to_size);
+		}
+	}
+	MICRO_PLY_FREE(weld.remap);
+
+	*out_verts      = MICRO_PLY_REALLOC(weld.verts, (size_t)(weld.unique > 0 ? weld.unique : 1) * vert_stride);
+	*out_vert_count = weld.unique;
+	*out_inds       = ind_data;
+	*out_ind_count  = ind_count;
+	return true;
+}
+
+///////////////////////////////////////////
+
+// Tom Forsyth's linear-speed vertex cache optimizer, see:
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+// Vertices score higher the more recently they were used, and the fewer
+// triangles they have left, and each step emits the best scoring triangle
+// touching the simulated cache. Only triangles of vertices in the cache
+// get rescored, so each step does a roughly constant amount of work.
+#define _PLY_CACHE_SIZE 32
+
+// Scores for each cache position, and for small live triangle counts.
+// These are filled per call rather than kept in globals, so optimizing
+// several meshes on different threads at once is safe.
+typedef struct _ply_score_table_t {
+	float cache  [_PLY_CACHE_SIZE];
+	float valence[64];
+} _ply_score_table_t;
+
+void _ply_score_table_init(_ply_score_table_t *table) {
+	for (int32_t i = 0; i < _PLY_CACHE_SIZE; i++) {
+		float x = 1.0f - (float)(i - 3) / (_PLY_CACHE_SIZE - 3);
+		table->cache[i] = i < 3 ? 0.75f : x * sqrtf(x);
+	}
+	table->valence[0] = 0;
+	for (int32_t i = 1; i < 64; i++)
+		table->valence[i] = 2.0f / sqrtf((float)i);
+}
+
+float _ply_vertex_score(const _ply_score_table_t *table, int32_t cache_pos, int32_t live_tris) {
+	if (live_tris == 0) return -1;
+	return (cache_pos >= 0 ? table->cache[cache_pos] : 0) +
+		(live_tris < 64 ? table->valence[live_tris] : 2.0f / sqrtf((float)live_tris));
+}
+
+void ply_optimize_vertex_cache(uint32_t *indices, int32_t index_count, int32_t vertex_count) {
+	// Out of range indices would make a mess of the adjacency, so those
+	// buffers are left as they are.
+	int32_t tri_count = index_count / 3;
+	for (int32_t i = 0; i < tri_count * 3; i++)
+		if (indices[i] >= (uint32_t)vertex_count) return;
+	if (tri_count == 0) return;
+	_ply_score_table_t table;
+	_ply_score_table_init(&table);
+
+	// Which triangles use each vertex, with the live ones at the start of
+	// each vertex's range
+	int32_t *offsets   = (int32_t*)_ply_calloc(vertex_count + 1, sizeof(int32_t));
+	int32_t *live      = (int32_t*)_ply_calloc(vertex_count,     sizeof(int32_t));
+	float   *v_score   = (float  *)MICRO_PLY_MALLOC(sizeof(float  ) * vertex_count);
+	int32_t *adjacency = (int32_t*)MICRO_PLY_MALLOC(sizeof(int32_t) * tri_count * 3);
+	float   *t_score   = (float  *)MICRO_PLY_MALLOC(sizeof(float  ) * tri_count);
+	bool    *emitted   = (bool   *)_ply_calloc(tri_count, sizeof(bool));
+	uint32_t*result    = (uint32_t*)MICRO_PLY_MALLOC(sizeof(uint32_t) * tri_count * 3);
+	for (int32_t i = 0; i < tri_count * 3; i++)
+		live[indices[i]] += 1;
+	for (int32_t v = 0; v < vertex_count; v++) {
+		offsets[v+1] = offsets[v] + live[v];
+		live[v]      = 0;
+	}
+	for (int32_t i = 0; i < tri_count * 3; i++) {
+		uint32_t v = indices[i];
+		adjacency[offsets[v] + live[v]++] = i / 3;
+	}
+	for (int32_t v = 0; v < vertex_count; v++)
+		v_score[v] = _ply_vertex_score(&table, -1, live[v]);
+	int32_t best_tri = 0;
+	for (int32_t t = 0; t < tri_count; t++) {
+		t_score[t] = v_score[indices[t*3]] + v_score[indices[t*3+1]] + v_score[indices[t*3+2]];
+		if (t_score[t] > t_score[best_tri]) best_tri = t;
+	}
+
+	int32_t cache[_PLY_CACHE_SIZE + 3];
+	int32_t cache_count = 0;
+	int32_t cursor      = 0;
+	for (int32_t out = 0; out < tri_count; out++) {
+		// With nothing useful in the cache, start again from the next
+		// triangle that hasn't been emitted.
+		if (best_tri < 0) {
+			while (emitted[cursor]) cursor++;
+			best_tri = cursor;
+		}
+
+		const uint32_t *tri = &indices[best_tri * 3];
+		result [out*3  ]  = tri[0];
+		result [out*3+1]  = tri[1];
+		result [out*3+2]  = tri[2];
+		emitted[best_tri] = true;
+
+		// Take the triangle off of its vertices' live lists
+		for (int32_t c = 0; c < 3; c++) {
+			uint32_t v     = tri[c];
+			int32_t *range = &adjacency[offsets[v]];
+			for (int32_t i = 0; i < live[v]; i++) {
+				if (range[i] != best_tri) continue;
+				range[i] = range[live[v] - 1];
+				live[v] -= 1;
+				break;
+			}
+		}
+
+		// The triangle's vertices go to the front of the cache
+		int32_t new_cache[_PLY_CACHE_SIZE + 3];
+		int32_t new_count = 0;
+		for (int32_t c = 0; c < 3; c++) {
+			if (new_count > 0 && (new_cache[0] == (int32_t)tri[c] || (new_count > 1 && new_cache[1] == (int32_t)tri[c]))) continue;
+			new_cache[new_count++] = (int32_t)tri[c];
+		}
+		for (int32_t i = 0; i < cache_count; i++) {
+			int32_t v = cache[i];
+			if (v == (int32_t)tri[0] || v == (int32_t)tri[1] || v == (int32_t)tri[2]) continue;
+			new_cache[new_count++] = v;
+		}
+
+		// Rescore everything that was in the cache, including the ones that
+		// just fell out. A triangle can touch several of these, so all the
+		// deltas need to land before any triangle's score is compared.
+		for (int32_t i = 0; i < new_count; i++) {
+			int32_t v       = new_cache[i];
+			int32_t pos     = i < _PLY_CACHE_SIZE ? i : -1;
+			float   score   = _ply_vertex_score(&table, pos, live[v]);
+			float   delta   = score - v_score[v];
+			v_score[v] = score;
+			for (int32_t a = 0; a < live[v]; a++)
+				t_score[adjacency[offsets[v] + a]] += delta;
+		}
+
+		// Then the best live triangle touching the cache is up next
+		cache_count = new_count < _PLY_CACHE_SIZE ? new_count : _PLY_CACHE_SIZE;
+		best_tri = -1;
+		float best_score = -1;
+		for (int32_t i = 0; i < cache_count; i++) {
+			int32_t v = new_cache[i];
+			for (int32_t a = 0; a < live[v]; a++) {
+				int32_t t = adjacency[offsets[v] + a];
+				if (t_score[t] > best_score) {
+					best_score = t_score[t];
+					best_tri   = t;
+				}
+			}
+		}
+		memcpy(cache, new_cache, sizeof(int32_t) * cache_count);
+	}
+	memcpy(indices, result, sizeof(uint32_t) * tri_count * 3);
+
+	MICRO_PLY_FREE(offsets);
+	MICRO_PLY_FREE(live);
+	MICRO_PLY_FREE(v_score);
+	MICRO_PLY_FREE(adjacency);
+	MICRO_PLY_FREE(t_score);
+	MICRO_PLY_FREE(emitted);
+	MICRO_PLY_FREE(result);
+}
+
+///////////////////////////////////////////
+
+// Puts vertices in the order the indices first use them, so vertex
+// fetches walk forward through memory. Unused vertices go at the end.
+void ply_optimize_vertex_fetch(void *vertices, int32_t vertex_count, int32_t vertex_stride, uint32_t *indices, int32_t index_count) {
+	int32_t *remap = (int32_t*)MICRO_PLY_MALLOC(sizeof(int32_t) * vertex_count);
+	memset(remap, 0xFF, sizeof(int32_t) * vertex_count);
+
+	int32_t next = 0;
+	for (int32_t i = 0; i < index_count; i++) {
+		uint32_t v = indices[i];
+		if (v >= (uint32_t)vertex_count) continue;
+		if (remap[v] == -1) remap[v] = next++;
+		indices[i] = (uint32_t)remap[v];
+	}
+	for (int32_t v = 0; v < vertex_count; v++) {
+		if (remap[v] == -1) remap[v] = next++;
+	}
+
+	uint8_t *src  = (uint8_t*)vertices;
+	uint8_t *dest = (uint8_t*)MICRO_PLY_MALLOC((size_t)vertex_count * vertex_stride);
+	for (int32_t v = 0; v < vertex_count; v++)
+		memcpy(dest + (size_t)remap[v] * vertex_stride, src + (size_t)v * vertex_stride, vertex_stride);
+	memcpy(vertices, dest, (size_t)vertex_count * vertex_stride);
+
+	MICRO_PLY_FREE(dest);
+	MICRO_PLY_FREE(remap);
+}
+
+///////////////////////////////////////////
+
+int32_t ply_convert_count(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count) {
+	const ply_element_t *elements = _ply_find_element(file, element_name);
+	return elements != nullptr
+		? _ply_convert_count(elements, to_format, format_count)
+		: 0;
+}
+
+///////////////////////////////////////////
+
+bool ply_convert_into(const ply_file_t *file, const char *element_name, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, const ply_convert_opts_t *opts, void *out_data, int32_t out_capacity, int32_t *out_count) {
+	*out_count = 0;
+	const ply_element_t *elements = _ply_find_element(file, element_name);
+	if (elements == nullptr || out_data == nullptr)
+		return false;
+
+	return _ply_convert_to(elements, to_format, format_count, format_stride, opts, &out_data, out_capacity, out_count);
+}
+
+///////////////////////////////////////////
+
+void ply_convert_multi(const ply_file_t *file, const char *element_name, ply_convert_target_t *targets, int32_t target_count) {
+	for (int32_t t = 0; t < target_count; t++) {
+		targets[t].out_data  = nullptr;
+		targets[t].out_count = 0;
+	}
+	const ply_element_t *elements = _ply_find_element(file, element_name);
+	if (elements == nullptr)
+		return;
+
+	// Triangulated lists make their own output, but everything else goes
+	// into one plan so the source rows only get read once.
+	int32_t total_ops = 0;
+	for (int32_t t = 0; t < target_count; t++)
+		total_ops += targets[t].format_count;
+	_ply_op_t *ops      = (_ply_op_t*)MICRO_PLY_MALLOC(sizeof(_ply_op_t) * total_ops);
+	int32_t    op_count = 0;
+	for (int32_t t = 0; t < target_count; t++) {
+		ply_convert_target_t *target = &targets[t];
+		target->out_count = _ply_convert_count(elements, target->to_format, target->format_count);
+		target->out_data  = MICRO_PLY_MALLOC((size_t)target->out_count * target->format_stride);
+		if (_ply_convert_list(elements, target->to_format, target->format_count) != -1)
+			_ply_convert_element(elements, target->to_format, target->format_count, target->format_stride, target->out_data);
+		else
+			op_count += _ply_plan(elements, target->to_format, target->format_count, (uint8_t*)target->out_data, target->format_stride, &ops[op_count]);
+	}
+	_ply_plan_run(elements, ops, op_count, nullptr, nullptr);
+	MICRO_PLY_FREE(ops);
+}
+
+///////////////////////////////////////////
+
+void ply_stream_begin(ply_stream_t *stream, int32_t batch_rows) {
+	*stream = {};
+	stream->batch_rows = batch_rows > 0 ? batch_rows : 4096;
+}
+
+///////////////////////////////////////////
+
+void ply_stream_map(ply_stream_t *stream, const char *element_name, const ply_map_t *to_format, int32_t format_count, int32_t format_stride, ply_stream_callback callback, void *user_data) {
+	ply_stream_target_t target = {};
+	strncpy(target.element_name, element_name, sizeof(target.element_name) - 1);
+	target.to_format     = to_format;
+	target.format_count  = format_count;
+	target.format_stride = format_stride;
+	target.callback      = callback;
+	target.user_data     = user_data;
+	target.element       = -1;
+
+	stream->target_count += 1;
+	stream->targets       = (ply_stream_target_t*)MICRO_PLY_REALLOC(stream->targets, sizeof(ply_stream_target_t) * stream->target_count);
+	stream->targets[stream->target_count - 1] = target;
+}
+
+///////////////////////////////////////////
+
+// Converts the rows we've collected for the current element, and hands
+// them off to anyone that's interested.
+void _ply_stream_flush(ply_stream_t *stream) {
+	ply_element_t *el = &stream->file.elements[stream->element];
+	if (stream->batch_count == 0) return;
+
+	ply_element_t batch = *el;
+	batch.count = stream->batch_count;
+	batch.data  = stream->batch;
+	if (_ply_list_count(el) == 1) {
+		batch.list_data = stream->batch_lists[0].data;
+	} else if (_ply_list_count(el) > 1) {
+		_ply_lists_pack(&batch, stream->batch_lists, &stream->batch_packed);
+		batch.list_data = stream->batch_packed.data;
+	}
+	if (_ply_list_count(el) > 0) {
+		stream->batch_offsets.size = 0;
+		batch.list_offsets = (uint64_t*)_ply_buffer_reserve(&stream->batch_offsets, sizeof(uint64_t) * (batch.count + 1) * _ply_list_count(el));
+		_ply_build_list_offsets(&batch, batch.list_offsets);
+	}
+
+	for (int32_t t = 0; t < stream->target_count; t++) {
+		ply_stream_target_t *target = &stream->targets[t];
+		if (target->element != stream->element) continue;
+
+		int32_t count = _ply_convert_count(&batch, target->to_format, target->format_count);
+		size_t  size  = (size_t)count * target->format_stride;
+		if (size > target->out_capacity) {
+			target->out_capacity = size;
+			target->out          = MICRO_PLY_REALLOC(target->out, size);
+		}
+		_ply_convert_element(&batch, target->to_format, target->format_count, target->format_stride, target->out);
+		target->callback(target->user_data, target->out, count);
+	}
+	stream->batch_count = 0;
+	for (int32_t l = 0; l < stream->batch_list_count; l++)
+		stream->batch_lists[l].size = 0;
+}
+
+///////////////////////////////////////////
+
+// Reads as much as it can from data, and reports how much was used. Rows
+// that are cut off by the end of data are left for later.
+bool _ply_stream_process(ply_stream_t *stream, const uint8_t *data, size_t size, bool final, size_t *out_used) {
+	const uint8_t *src = data;
+	const uint8_t *end = data + size;
+	*out_used = 0;
+
+	if (!stream->header_done) {
+		size_t header_size = _ply_header_size((const char*)data, size);
+		if (header_size == 0) return !final;
+		if (!_ply_read_header((const char*)data, &stream->file, &stream->format)) return false;
+		stream->header_done = true;
+		src += header_size;
+
+		for (int32_t i = 0; i < stream->file.count; i++) {
+			int32_t list_count = _ply_list_count(&stream->file.elements[i]);
+			if (list_count > stream->batch_list_count) stream->batch_list_count = list_count;
+		}
+		stream->batch_lists = (_ply_buffer_t*)_ply_calloc(stream->batch_list_count, sizeof(_ply_buffer_t));
+		stream->batch_marks = (size_t       *)_ply_calloc(stream->batch_list_count, sizeof(size_t));
+
+		for (int32_t t = 0; t < stream->target_count; t++) {
+			const ply_element_t *el = _ply_find_element(&stream->file, stream->targets[t].element_name);
+			if (el) stream->targets[t].element = (int32_t)(el - stream->file.elements);
+		}
+	}
+
+	while (stream->element < stream->file.count) {
+		ply_element_t *el = &stream->file.elements[stream->element];
+		if (stream->row >= el->count) {
+			_ply_stream_flush(stream);
+			stream->element += 1;
+			stream->row      = 0;
+			continue;
+		}
+
+		size_t batch_size = (size_t)stream->batch_rows * el->data_stride;
+		if (batch_size > stream->batch_capacity) {
+			stream->batch_capacity = batch_size;
+			stream->batch          = (uint8_t*)MICRO_PLY_REALLOC(stream->batch, batch_size);
+		}
+
+		// A row that gets cut off may have already added to some of the
+		// lists, so those need rolled back.
+		for (int32_t l = 0; l < stream->batch_list_count; l++)
+			stream->batch_marks[l] = stream->batch_lists[l].size;
+		const uint8_t *next = _ply_read_row(el, stream->format, src, end, final, stream->batch + (size_t)stream->batch_count * el->data_stride, stream->batch_lists);
+		if (next == nullptr) {
+			for (int32_t l = 0; l < stream->batch_list_count; l++)
+				stream->batch_lists[l].size = stream->batch_marks[l];
+			break;
+		}
+
+		src                 = next;
+		stream->row        += 1;
+		stream->batch_count += 1;
+		if (stream->batch_count >= stream->batch_rows)
+			_ply_stream_flush(stream);
+	}
+	*out_used = src - data;
+	return true;
+}
+
+///////////////////////////////////////////
+
+bool ply_stream_feed(ply_stream_t *stream, const void *data, size_t size) {
+	const uint8_t *src  = (const uint8_t*)data;
+	size_t         used = 0;
+
+	// If a row got cut off last time, finish it off by adding a bit of the
+	// new data at a time. This way we only copy as much as the partial row
+	// needs, instead of everything.
+	while (stream->carry_size > 0 && size > 0) {
+		size_t old  = stream->carry_size;
+		size_t take = size < 4096 ? size : 4096;
+		if (old + take > stream->carry_capacity) {
+			stream->carry_capacity = old + take;
+			stream->carry          = (uint8_t*)MICRO_PLY_REALLOC(stream->carry, stream->carry_capacity);
+		}
+		memcpy(stream->carry + old, src, take);
+		stream->carry_size = old + take;
+
+		if (!_ply_stream_process(stream, stream->carry, stream->carry_size, false, &used)) return false;
+		if (used >= old) {
+			// Everything from the carry is done, the rest is still in data
+			stream->carry_size = 0;
+			src  += used - old;
+			size -= used - old;
+		} else {
+			memmove(stream->carry, stream->carry + used, stream->carry_size - used);
+			stream->carry_size -= used;
+			src  += take;
+			size -= take;
+		}
+	}
+	if (size == 0) return true;
+
+	if (!_ply_stream_process(stream, src, size, false, &used)) return false;
+	size_t left = size - used;
+	if (left > stream->carry_capacity) {
+		stream->carry_capacity = left;
+		stream->carry          = (uint8_t*)MICRO_PLY_REALLOC(stream->carry, left);
+	}
+	if (left > 0) memcpy(stream->carry, src + used, left);
+	stream->carry_size = left;
+	return true;
+}
+
+///////////////////////////////////////////
+
+bool ply_stream_end(ply_stream_t *stream) {
+	// Whatever's left over is the last of the file, so any partial rows
+	// here are incomplete for good.
+	size_t used   = 0;
+	bool   result =
+		_ply_stream_process(stream, stream->carry, stream->carry_size, true, &used) &&
+		stream->header_done &&
+		stream->element == stream->file.count;
+
+	for (int32_t t = 0; t < stream->target_count; t++)
+		MICRO_PLY_FREE(stream->targets[t].out);
+	MICRO_PLY_FREE(stream->targets);
+	MICRO_PLY_FREE(stream->carry);
+	MICRO_PLY_FREE(stream->batch);
+	for (int32_t l = 0; l < stream->batch_list_count; l++)
+		MICRO_PLY_FREE(stream->batch_lists[l].data);
+	MICRO_PLY_FREE(stream->batch_lists);
+	MICRO_PLY_FREE(stream->batch_marks);
+	MICRO_PLY_FREE(stream->batch_packed.data);
+	MICRO_PLY_FREE(stream->batch_offsets.data);
+	ply_free(&stream->file);
+	*stream = {};
+	return result;
+}
+
+///////////////////////////////////////////
+
+const void *ply_get_list(const ply_element_t *element, int32_t property, int32_t row, int32_t *out_count) {
+	*out_count = 0;
+	if (property < 0 || property >= element->property_count || row < 0 || row >= element->count || element->list_offsets == nullptr) return nullptr;
+	const ply_prop_t *prop = &element->properties[property];
+	if (prop->list_type == 0) return nullptr;
+
+	const uint64_t *offsets = element->list_offsets + (size_t)_ply_list_index(element, property) * (element->count + 1);
+	*out_count = (int32_t)(offsets[row+1] - offsets[row]);
+	return (const uint8_t*)element->list_data + prop->list_offset + offsets[row] * prop->list_bytes;
+}
+
+///////////////////////////////////////////
+
+// Writes go through a buffer, so the sink sees big chunks instead of a
+// call for every row. Anything bigger than the buffer, like a whole
+// element's data, goes straight through.
+typedef struct _ply_writer_t {
+	ply_write_fn write;
+	void        *user_data;
+	uint8_t     *buffer;
+	size_t       size;
+	size_t       capacity;
+	bool         failed;
+} _ply_writer_t;
+
+void _ply_write_flush(_ply_writer_t *w) {
+	if (w->size > 0 && !w->failed)
+		w->failed = !w->write(w->user_data, w->buffer, w->size);
+	w->size = 0;
+}
+
+void _ply_write_bytes(_ply_writer_t *w, const void *data, size_t size) {
+	if (size == 0) return;
+	if (w->size + size > w->capacity) _ply_write_flush(w);
+	if (size >= w->capacity) {
+		if (!w->failed) w->failed = !w->write(w->user_data, data, size);
+		return;
+	}
+	memcpy(w->buffer + w->size, data, size);
+	w->size += size;
+}
+
+void _ply_write_str(_ply_writer_t *w, const char *str) {
+	_ply_write_bytes(w, str, strlen(str));
+}
+
+void _ply_write_int(_ply_writer_t *w, int64_t val) {
+	char  digits[24];
+	char *curr = digits + sizeof(digits);
+	bool  neg  = val < 0;
+	uint64_t u = neg ? 0 - (uint64_t)val : (uint64_t)val;
+	do { *--curr = (char)('0' + u % 10); u /= 10; } while (u != 0);
+	if (neg) *--curr = '-';
+	_ply_write_bytes(w, curr, digits + sizeof(digits) - curr);
+}
+
+// PLY only has names for types up to 32 bit integers
+const char *_ply_type_name(uint8_t type, uint8_t bytes) {
+	switch (type) {
+	case ply_prop_int:     return bytes == 1 ? "char"  : bytes == 2 ? "short"  : bytes == 4 ? "int"  : nullptr;
+	case ply_prop_uint:    return bytes == 1 ? "uchar" : bytes == 2 ? "ushort" : bytes == 4 ? "uint" : nullptr;
+	case ply_prop_decimal: return bytes == 4 ? "float" : bytes == 8 ? "double" : nullptr;
+	}
+	return nullptr;
+}
+
+bool _ply_write_property(_ply_writer_t *w, const char *name, uint8_t type, uint8_t bytes, uint8_t list_type, uint8_t list_bytes) {
+	const char *type_name = _ply_type_name(type, bytes);
+	const char *list_name = _ply_type_name(list_type, list_bytes);
+	if (type_name == nullptr || (list_type != 0 && list_name == nullptr)) return false;
+
+	_ply_write_str(w, "property ");
+	if (list_type != 0) {
+		_ply_write_str(w, "list ");
+		_ply_write_str(w, type_name);
+		_ply_write_str(w, " ");
+		_ply_write_str(w, list_name);
+	} else {
+		_ply_write_str(w, type_name);
+	}
+	_ply_write_str(w, " ");
+	_ply_write_str(w, name);
+	_ply_write_str(w, "\n");
+	return true;
+}
+
+void _ply_write_element_line(_ply_writer_t *w, const char *name, int32_t count) {
+	_ply_write_str(w, "element ");
+	_ply_write_str(w, name);
+	_ply_write_str(w, " ");
+	_ply_write_int(w, count);
+	_ply_write_str(w, "\n");
+}
+
+void _ply_write_begin(_ply_writer_t *w, ply_write_fn write, void *user_data) {
+	*w = {};
+	w->write     = write;
+	w->user_data = user_data;
+	w->capacity  = 64 * 1024;
+	w->buffer    = (uint8_t*)MICRO_PLY_MALLOC(w->capacity);
+	// Data goes out exactly as it is in memory, so the header names this
+	// machine's byte order. Readers swap for themselves if they need to.
+	_ply_write_str(w, _ply_needs_swap(1)
+		? "ply\nformat binary_big_endian 1.0\n"
+		: "ply\nformat binary_little_endian 1.0\n");
+}
+
+bool _ply_write_end(_ply_writer_t *w) {
+	_ply_write_flush(w);
+	MICRO_PLY_FREE(w->buffer);
+	return !w->failed;
+}
+
+///////////////////////////////////////////
+
+bool ply_write(const ply_file_t *file, ply_write_fn write, void *user_data) {
+	_ply_writer_t w;
+	_ply_write_begin(&w, write, user_data);
+	bool result = true;
+	for (int32_t i = 0; result && i < file->count; i++) {
+		const ply_element_t *el = &file->elements[i];
+		_ply_write_element_line(&w, el->name, el->count);
+		for (int32_t p = 0; result && p < el->property_count; p++) {
+			const ply_prop_t *prop = &el->properties[p];
+			result = _ply_write_property(&w, prop->name, prop->type, prop->bytes, prop->list_type, prop->list_bytes);
+		}
+	}
+	_ply_write_str(&w, "end_header\n");
+
+	for (int32_t i = 0; result && i < file->count; i++) {
+		const ply_element_t *el = &file->elements[i];
+
+		// Decoded rows without lists are already rows in this machine's
+		// byte order, which is the format the header promised
+		if (_ply_list_prop(el) == -1 && el->lazy_rows == nullptr) {
+			_ply_write_bytes(&w, el->data, (size_t)el->data_stride * el->count);
+			continue;
+		}
+
+		// Lazy ones get decoded a block at a time
+		if (el->lazy_rows != nullptr) {
+			const int32_t  block   = 256;
+			uint8_t       *columns = (uint8_t*)MICRO_PLY_MALLOC(el->property_count);
+			uint8_t       *scratch = (uint8_t*)MICRO_PLY_MALLOC((size_t)el->data_stride * block);
+			const uint8_t *src     = (const uint8_t*)el->lazy_rows;
+			memset(columns, 1, el->property_count);
+			for (int32_t start = 0; start < el->count; start += block) {
+				int32_t rows = el->count - start < block ? el->count - start : block;
+				src = _ply_lazy_decode(el, columns, el->property_count - 1, src, rows, scratch);
+				_ply_write_bytes(&w, scratch, (size_t)el->data_stride * rows);
+			}
+			MICRO_PLY_FREE(scratch);
+			MICRO_PLY_FREE(columns);
+			continue;
+		}
+
+		// Rows with lists interleave the row's values with list items
+		const uint8_t *row = (const uint8_t*)el->data;
+		for (int32_t r = 0; r < el->count; r++) {
+			for (int32_t l = 0, p = 0; p < el->property_count; p++) {
+				const ply_prop_t *prop = &el->properties[p];
+				_ply_write_bytes(&w, row + prop->offset, prop->bytes);
+				if (prop->list_type == 0) continue;
+
+				const uint64_t *offsets = el->list_offsets + (size_t)l++ * (el->count + 1);
+				_ply_write_bytes(&w,
+					(const uint8_t*)el->list_data + prop->list_offset + offsets[r] * prop->list_bytes,
+					(offsets[r+1] - offsets[r]) * prop->list_bytes);
+			}
+			row += el->data_stride;
+		}
+	}
+	return _ply_write_end(&w) && result;
+}
+
+///////////////////////////////////////////
+
+bool ply_write_data(const ply_write_element_t *elements, int32_t element_count, ply_write_fn write, void *user_data) {
+	_ply_writer_t w;
+	_ply_write_begin(&w, write, user_data);
+	bool result = true;
+	for (int32_t i = 0; result && i < element_count; i++) {
+		const ply_write_element_t *el = &elements[i];
+		_ply_write_element_line(&w, el->name, el->count);
+		for (int32_t f = 0; result && f < el->format_count; f++) {
+			const ply_map_t *map = &el->format[f];
+			result = f == 0 && el->list_size > 0
+				? _ply_write_property(&w, map->name, ply_prop_uint, 1, map->to_type, map->to_size) && el->list_size <= 255
+				: _ply_write_property(&w, map->name, map->to_type, map->to_size, 0, 0);
+		}
+	}
+	_ply_write_str(&w, "end_header\n");
+
+	for (int32_t i = 0; result && i < element_count; i++) {
+		const ply_write_element_t *el = &elements[i];
+		const uint8_t             *src = (const uint8_t*)el->data;
+
+		// The output row is every property packed together. When the
+		// struct is laid out the same way, it can go out as one block.
+		int32_t row_size = 0;
+		bool    packed   = el->list_size == 0;
+		for (int32_t f = 0; f < el->format_count; f++) {
+			const ply_map_t *map = &el->format[f];
+			packed    = packed && map->to_offset == row_size;
+			row_size += f == 0 && el->list_size > 0
+				? 1 + map->to_size * el->list_size
+				: map->to_size;
+		}
+		if (row_size == 0) continue;
+		if (packed && row_size == el->format_stride) {
+			_ply_write_bytes(&w, src, (size_t)row_size * el->count);
+			continue;
+		}
+
+		// Otherwise, rows are gathered a block at a time, with one strided
+		// copy for each column.
+		const int32_t block = w.capacity / row_size > 0 ? (int32_t)(w.capacity / row_size) : 1;
+		uint8_t      *rows  = (uint8_t*)MICRO_PLY_MALLOC((size_t)row_size * block);
+		for (int32_t start = 0; start < el->count; start += block) {
+			int32_t count  = el->count - start < block ? el->count - start : block;
+			int32_t offset = 0;
+			for (int32_t f = 0; f < el->format_count; f++) {
+				const ply_map_t *map  = &el->format[f];
+				const uint8_t   *col  = src + (size_t)start * el->format_stride + map->to_offset;
+				int32_t          size = map->to_size;
+				if (f == 0 && el->list_size > 0) {
+					uint8_t list_count = (uint8_t)el->list_size;
+					_ply_kernel_copy(rows + offset, row_size, &list_count, 0, count, 1);
+					offset += 1;
+					size   *= el->list_size;
+				}
+				_ply_kernel_copy(rows + offset, row_size, col, el->format_stride, count, size);
+				offset += size;
+			}
+			_ply_write_bytes(&w, rows, (size_t)row_size * count);
+		}
+		MICRO_PLY_FREE(rows);
+	}
+	return _ply_write_end(&w) && result;
+}
+
+///////////////////////////////////////////
+
+void ply_free(ply_file_t *file) {
+	for (int32_t i = 0; i < file->count; i++) {
+		if (!file->elements[i].data_borrowed)
+			MICRO_PLY_FREE(file->elements[i].data);
+		MICRO_PLY_FREE(file->elements[i].list_data);
+		MICRO_PLY_FREE(file->elements[i].list_offsets);
+		MICRO_PLY_FREE(file->elements[i].properties);
+	}
+	MICRO_PLY_FREE(file->elements);
+#ifdef _MICRO_PLY_MMAP
+	if (file->source_mapped) munmap(file->source, file->source_size);
+	else
+#endif
+	MICRO_PLY_FREE(file->source);
+	*file = {};
 }
 
 #endif